@@ -65,10 +65,42 @@ class domain(object):
                        requires that the product of all three numbers match the total number
                        of processes selected when running the simulation.
     :vartype nproc: tuple
+    :ivar exchange: Method used to exchange ghost cells between processes (string, default
+                       ``'nonblocking'``). Options are ``'nonblocking'`` (nonblocking point-to-point
+                       messages), ``'persistent'`` (persistent requests created once and restarted
+                       every stage), ``'neighbor'`` (neighborhood collective on the Cartesian
+                       process topology), or ``'shared'`` (shared memory for processes on the same
+                       node, nonblocking messages otherwise).
+    :vartype exchange: str
+    :ivar deep_halo: Whether to widen the ghost cells so that they are only exchanged once per time
+                       step rather than at every Runge-Kutta stage (boolean, default ``False``).
+                       Only used with the ``'nonblocking'`` or ``'persistent'`` exchange methods.
+    :vartype deep_halo: bool
+    :ivar decomposition: Method used to divide grid points among processes (string, default
+                       ``'uniform'``). Options are ``'uniform'`` (equal number of grid points on each
+                       process) or ``'weighted'`` (equal estimated cost on each process, accounting
+                       for plasticity and interfaces).
+    :vartype decomposition: str
     :ivar cdiss: Artificial dissipation coefficient (float, default 0.). A nonzero value will
                       turn on artificial dissipation in the simulation. It is up to the user to select
                       this value correctly.
     :vartype cdiss: float
+    :ivar kernel: Instruction set used for interior finite difference kernels (string, default
+                      ``'auto'``). Options are ``'auto'``, ``'avx512'``, ``'avx2'``, ``'sse2'``, or
+                      ``'scalar'``. Does not change the simulation results.
+    :vartype kernel: str
+    :ivar tile: Tile size in the x and y directions for the 3D interior kernels (tuple of two integers,
+                      default ``(0, 0)``). Zero selects the size automatically. Does not change the
+                      simulation results.
+    :vartype tile: tuple
+    :ivar layout: Storage of grid coefficients for the 3D curvilinear interior kernels (string, default
+                      ``'lean'``). Options are ``'lean'`` or ``'precomputed'``, which uses more memory
+                      to reduce the number of operations.
+    :vartype layout: str
+    :ivar stage: Execution of Runge-Kutta stages (string, default ``'separate'``). Options are
+                      ``'separate'`` or ``'fused'``, which updates the fields while computing the rates
+                      to reduce memory traffic. Does not change the simulation results.
+    :vartype stage: str
     """
     def __init__(self):
         """
@@ -94,7 +126,14 @@ class domain(object):
         self.iftype = []
         self.sbporder = 2
         self.nproc = (0, 0, 0)
+        self.exchange = 'nonblocking'
+        self.deep_halo = False
+        self.decomposition = 'uniform'
         self.cdiss = 0.
+        self.kernel = 'auto'
+        self.tile = (0, 0)
+        self.layout = 'lean'
+        self.stage = 'separate'
 
         self.f = fields(self.ndim, self.mode)
         self.blocks = ([[[block(self.ndim, self.mode, (self.nx_block[0][0], self.nx_block[1][0], self.nx_block[2][0]),
@@ -235,6 +274,79 @@ class domain(object):
         if self.ndim == 2:
             self.nproc[2] = 1
 
+    def get_exchange(self):
+        """
+        Returns method used to exchange ghost cells between processes
+
+        :returns: Ghost cell exchange method (``'nonblocking'``, ``'persistent'``, ``'neighbor'``, or ``'shared'``)
+        :rtype: str
+        """
+        return self.exchange
+
+    def set_exchange(self, exchange):
+        """
+        Sets method used to exchange ghost cells between processes
+
+        Options are ``'nonblocking'`` (default), ``'persistent'``, ``'neighbor'``, or ``'shared'``. All methods
+        give identical results, so this only affects performance.
+
+        :param exchange: New ghost cell exchange method
+        :type exchange: str
+        :returns: None
+        """
+        assert (exchange == 'nonblocking' or exchange == 'persistent' or exchange == 'neighbor' or
+                exchange == 'shared'), "Exchange method must be nonblocking, persistent, neighbor, or shared"
+        self.exchange = exchange
+
+    def get_deep_halo(self):
+        """
+        Returns whether ghost cells are exchanged once per time step using a deep halo
+
+        :returns: Whether deep halo exchange is used
+        :rtype: bool
+        """
+        return self.deep_halo
+
+    def set_deep_halo(self, deep_halo):
+        """
+        Sets whether ghost cells are exchanged once per time step using a deep halo
+
+        If ``True``, the ghost cells are widened to cover all Runge-Kutta stages and are only exchanged
+        once per time step. This is only used with the ``'nonblocking'`` or ``'persistent'`` exchange
+        methods, and only when no process boundary is close to a block edge or interface (otherwise the
+        code falls back to exchanging at every stage). Results are identical in either case.
+
+        :param deep_halo: New value of deep halo flag
+        :type deep_halo: bool
+        :returns: None
+        """
+        self.deep_halo = bool(deep_halo)
+
+    def get_decomposition(self):
+        """
+        Returns method used to divide grid points among processes
+
+        :returns: Domain decomposition method (``'uniform'`` or ``'weighted'``)
+        :rtype: str
+        """
+        return self.decomposition
+
+    def set_decomposition(self, decomposition):
+        """
+        Sets method used to divide grid points among processes
+
+        Options are ``'uniform'`` (default), where each process has approximately the same number of grid
+        points, or ``'weighted'``, where process boundaries are placed so that each process has approximately
+        the same estimated cost based on the material type and the interfaces. This does not change the
+        simulation results.
+
+        :param decomposition: New domain decomposition method
+        :type decomposition: str
+        :returns: None
+        """
+        assert (decomposition == 'uniform' or decomposition == 'weighted'), "Decomposition method must be uniform or weighted"
+        self.decomposition = decomposition
+
     def get_cdiss(self):
         """
         Returns artificial dissipation coefficient
@@ -262,6 +374,109 @@ class domain(object):
         assert cdiss >= 0., "Dissipation coefficient must be nonnegative"
         self.cdiss = float(cdiss)
 
+    def get_kernel(self):
+        """
+        Returns instruction set used for interior finite difference kernels
+
+        :returns: Interior kernel instruction set
+        :rtype: str
+        """
+        return self.kernel
+
+    def set_kernel(self, kernel):
+        """
+        Sets instruction set used for interior finite difference kernels
+
+        Options are ``'auto'`` (default), which uses the widest vector instructions supported by the
+        processor, ``'avx512'``, ``'avx2'``, ``'sse2'``, or ``'scalar'``, which uses the original kernels
+        everywhere. If the requested instruction set is not supported, the code falls back to the best
+        available option. This does not change the simulation results.
+
+        :param kernel: New interior kernel instruction set
+        :type kernel: str
+        :returns: None
+        """
+        assert (kernel == 'auto' or kernel == 'avx512' or kernel == 'avx2' or kernel == 'sse2' or
+                kernel == 'scalar'), "Kernel must be auto, avx512, avx2, sse2, or scalar"
+        self.kernel = kernel
+
+    def get_tile(self):
+        """
+        Returns tile size in the x and y directions for the 3D interior kernels
+
+        :returns: Tile size (zero indicates that the size is selected automatically)
+        :rtype: tuple
+        """
+        return self.tile
+
+    def set_tile(self, tile):
+        """
+        Sets tile size in the x and y directions for the 3D interior kernels
+
+        In 3D, the interior kernels sweep through the block in tiles in the x and y directions that
+        extend over the full block in the z direction, so that grid points needed by the finite
+        difference stencil remain in cache. A value of zero selects the tile size automatically based on
+        the cache size. This does not change the simulation results, and is ignored in 2D.
+
+        :param tile: New tile size (tuple of two nonnegative integers)
+        :type tile: tuple
+        :returns: None
+        """
+        assert len(tile) == 2, "Tile size must have two entries"
+        assert tile[0] >= 0 and tile[1] >= 0, "Tile size must be nonnegative"
+        self.tile = (int(tile[0]), int(tile[1]))
+
+    def get_layout(self):
+        """
+        Returns storage of grid coefficients for the 3D curvilinear interior kernels
+
+        :returns: Grid coefficient layout (``'lean'`` or ``'precomputed'``)
+        :rtype: str
+        """
+        return self.layout
+
+    def set_layout(self, layout):
+        """
+        Sets storage of grid coefficients for the 3D curvilinear interior kernels
+
+        Options are ``'lean'`` (default), which uses the metric and Jacobian directly, or ``'precomputed'``,
+        which stores the product of the Jacobian and metric and the metric scaled by the material properties
+        at each grid point. The precomputed layout uses additional memory (the code prints the memory used
+        when the simulation starts) and changes results only at the level of floating point roundoff.
+
+        :param layout: New grid coefficient layout
+        :type layout: str
+        :returns: None
+        """
+        assert (layout == 'lean' or layout == 'precomputed'), "Layout must be lean or precomputed"
+        self.layout = layout
+
+    def get_stage(self):
+        """
+        Returns execution of Runge-Kutta stages
+
+        :returns: Runge-Kutta stage execution (``'separate'`` or ``'fused'``)
+        :rtype: str
+        """
+        return self.stage
+
+    def set_stage(self, stage):
+        """
+        Sets execution of Runge-Kutta stages
+
+        Options are ``'separate'`` (default), which scales the rates by the Runge-Kutta coefficient and
+        updates the fields in separate passes over the full arrays, or ``'fused'``, which scales the rates
+        as they are computed and updates the fields in each block as soon as the rates are final. For 3D
+        problems using the vectorized kernels, most of the fields are updated tile by tile while the rates
+        are still in cache. This does not change the simulation results.
+
+        :param stage: New Runge-Kutta stage execution
+        :type stage: str
+        :returns: None
+        """
+        assert (stage == 'separate' or stage == 'fused'), "Stage must be separate or fused"
+        self.stage = stage
+
     def get_nx(self):
         """
         Returns number of grid points in (nx, ny, nz) format
@@ -1146,6 +1361,31 @@ class domain(object):
         """
         self.f.set_plastic_tensor(plastic_tensor)
 
+    def get_plastic_margin(self):
+        """
+        Returns threshold on yield margin used to skip plasticity calculations
+
+        :returns: Yield margin threshold (zero means all points are checked)
+        :rtype: float
+        """
+        return self.f.get_plastic_margin()
+
+    def set_plastic_margin(self, plastic_margin):
+        """
+        Sets threshold on yield margin used to skip plasticity calculations
+
+        Method sets the threshold on the yield margin (yield stress minus shear stress) used to
+        track the points where plasticity must be checked. Points are skipped only if the stresses
+        cannot have changed enough to come within the threshold of the yield surface since they
+        were last checked. Zero (the default) checks all points on every time step. Must be
+        nonnegative.
+
+        :param plastic_margin: New value of yield margin threshold (must be nonnegative)
+        :type plastic_margin: float
+        :returns: None
+        """
+        self.f.set_plastic_margin(plastic_margin)
+
     def get_nifaces(self):
         """
         Returns number of interfaces
@@ -1630,14 +1870,31 @@ class domain(object):
         f.write(self.mattype+"\n")
         f.write("\n")
 
-        if not self.nproc == (0, 0, 0):
+        if (not self.nproc == (0, 0, 0) or not self.exchange == 'nonblocking' or self.deep_halo or
+            not self.decomposition == 'uniform'):
             f.write("[fdfault.cartesian]\n")
             f.write(str(self.nproc[0])+" "+str(self.nproc[1])+" "+str(self.nproc[2])+"\n")
+            if self.deep_halo:
+                f.write(self.exchange+" deep\n")
+            elif not self.exchange == 'nonblocking' or not self.decomposition == 'uniform':
+                f.write(self.exchange+"\n")
+            if not self.decomposition == 'uniform':
+                f.write(self.decomposition+"\n")
             f.write("\n")
 
-        if not self.cdiss == 0.:
+        if (not self.cdiss == 0. or not self.kernel == 'auto' or not self.tile == (0, 0) or
+            not self.layout == 'lean' or not self.stage == 'separate'):
             f.write("[fdfault.operator]\n")
             f.write(str(self.cdiss)+"\n")
+            if (not self.kernel == 'auto' or not self.tile == (0, 0) or not self.layout == 'lean' or
+                not self.stage == 'separate'):
+                f.write(self.kernel+"\n")
+            if not self.tile == (0, 0) or not self.layout == 'lean' or not self.stage == 'separate':
+                f.write(str(self.tile[0])+" "+str(self.tile[1])+"\n")
+            if not self.layout == 'lean' or not self.stage == 'separate':
+                f.write(self.layout+"\n")
+            if not self.stage == 'separate':
+                f.write(self.stage+"\n")
             f.write("\n")
         
         self.f.write_input(f, probname, directory, endian)
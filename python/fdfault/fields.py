@@ -37,6 +37,9 @@ class fields(object):
     :vartype s0: list
     :ivar plastic_tensor: If true, calculate full plastic strain tensor (default is ``False``)
     :vartype plastic_tensor: bool
+    :ivar plastic_margin: Threshold on yield margin for skipping plasticity calculations at points far from
+                  the yield surface (default is ``0.``, which checks all points)
+    :vartype plastic_margin: float
     :ivar s: Numpy array holding heterogeneous stress field (or ``None`` if no heterogeneous stress)
     :vartype s: ndarray or None
     :ivar mat: Numpy array holding heterogeneous material properties (or ``None`` if none)
@@ -65,6 +68,7 @@ class fields(object):
         self.material = "elastic"
         self.s0 = [0., 0., 0., 0., 0., 0.]
         self.plastic_tensor = False
+        self.plastic_margin = 0.
         self.s = None
         self.mat = None
         
@@ -239,6 +243,32 @@ class fields(object):
         :returns: None
         """
         self.plastic_tensor = bool(plastic_tensor)
+
+    def get_plastic_margin(self):
+        """
+        Returns threshold on yield margin used to skip plasticity calculations
+
+        :returns: Yield margin threshold (zero means all points are checked)
+        :rtype: float
+        """
+        return self.plastic_margin
+
+    def set_plastic_margin(self, plastic_margin):
+        """
+        Sets threshold on yield margin used to skip plasticity calculations
+
+        Method sets the threshold on the yield margin (yield stress minus shear stress) used to
+        track the points where plasticity must be checked. Points are skipped only if the stresses
+        cannot have changed enough to come within the threshold of the yield surface since they
+        were last checked. Zero (the default) checks all points on every time step. Must be
+        nonnegative.
+
+        :param plastic_margin: New value of yield margin threshold (must be nonnegative)
+        :type plastic_margin: float
+        :returns: None
+        """
+        assert float(plastic_margin) >= 0., "plastic margin must be nonnegative"
+        self.plastic_margin = float(plastic_margin)
         
     def write_input(self,f, probname, directory, endian = '='):
         """
@@ -295,6 +325,7 @@ class fields(object):
                 matfile.write(self.mat[i].astype(endian+'f8').tobytes())
             matfile.close()
         f.write(str(int(self.plastic_tensor))+"\n")
+        f.write(repr(self.plastic_margin)+"\n")
         f.write("\n")
 
     def __str__(self):
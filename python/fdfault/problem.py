@@ -415,6 +415,76 @@ class problem(object):
         """
         self.d.set_nproc(nproc)
 
+    def get_exchange(self):
+        """
+        Returns method used to exchange ghost cells between processes
+
+        :returns: Ghost cell exchange method (``'nonblocking'``, ``'persistent'``, ``'neighbor'``, or ``'shared'``)
+        :rtype: str
+        """
+        return self.d.get_exchange()
+
+    def set_exchange(self, exchange):
+        """
+        Sets method used to exchange ghost cells between processes
+
+        Options are ``'nonblocking'`` (default), ``'persistent'``, ``'neighbor'``, or ``'shared'``. All methods
+        give identical results, so this only affects performance.
+
+        :param exchange: New ghost cell exchange method
+        :type exchange: str
+        :returns: None
+        """
+        self.d.set_exchange(exchange)
+
+    def get_deep_halo(self):
+        """
+        Returns whether ghost cells are exchanged once per time step using a deep halo
+
+        :returns: Whether deep halo exchange is used
+        :rtype: bool
+        """
+        return self.d.get_deep_halo()
+
+    def set_deep_halo(self, deep_halo):
+        """
+        Sets whether ghost cells are exchanged once per time step using a deep halo
+
+        If ``True``, the ghost cells are widened to cover all Runge-Kutta stages and are only exchanged
+        once per time step. This is only used with the ``'nonblocking'`` or ``'persistent'`` exchange
+        methods, and only when no process boundary is close to a block edge or interface (otherwise the
+        code falls back to exchanging at every stage). Results are identical in either case.
+
+        :param deep_halo: New value of deep halo flag
+        :type deep_halo: bool
+        :returns: None
+        """
+        self.d.set_deep_halo(deep_halo)
+
+    def get_decomposition(self):
+        """
+        Returns method used to divide grid points among processes
+
+        :returns: Domain decomposition method (``'uniform'`` or ``'weighted'``)
+        :rtype: str
+        """
+        return self.d.get_decomposition()
+
+    def set_decomposition(self, decomposition):
+        """
+        Sets method used to divide grid points among processes
+
+        Options are ``'uniform'`` (default), where each process has approximately the same number of grid
+        points, or ``'weighted'``, where process boundaries are placed so that each process has approximately
+        the same estimated cost based on the material type and the interfaces. This does not change the
+        simulation results.
+
+        :param decomposition: New domain decomposition method
+        :type decomposition: str
+        :returns: None
+        """
+        self.d.set_decomposition(decomposition)
+
     def get_cdiss(self):
         """
         Returns artificial dissipation coefficient
@@ -441,6 +511,103 @@ class problem(object):
         """
         self.d.set_cdiss(cdiss)
 
+    def get_kernel(self):
+        """
+        Returns instruction set used for interior finite difference kernels
+
+        :returns: Interior kernel instruction set
+        :rtype: str
+        """
+        return self.d.get_kernel()
+
+    def set_kernel(self, kernel):
+        """
+        Sets instruction set used for interior finite difference kernels
+
+        Options are ``'auto'`` (default), which uses the widest vector instructions supported by the
+        processor, ``'avx512'``, ``'avx2'``, ``'sse2'``, or ``'scalar'``, which uses the original kernels
+        everywhere. If the requested instruction set is not supported, the code falls back to the best
+        available option. This does not change the simulation results.
+
+        :param kernel: New interior kernel instruction set
+        :type kernel: str
+        :returns: None
+        """
+        self.d.set_kernel(kernel)
+
+    def get_tile(self):
+        """
+        Returns tile size in the x and y directions for the 3D interior kernels
+
+        :returns: Tile size (zero indicates that the size is selected automatically)
+        :rtype: tuple
+        """
+        return self.d.get_tile()
+
+    def set_tile(self, tile):
+        """
+        Sets tile size in the x and y directions for the 3D interior kernels
+
+        In 3D, the interior kernels sweep through the block in tiles in the x and y directions that
+        extend over the full block in the z direction, so that grid points needed by the finite
+        difference stencil remain in cache. A value of zero selects the tile size automatically based on
+        the cache size. This does not change the simulation results, and is ignored in 2D.
+
+        :param tile: New tile size (tuple of two nonnegative integers)
+        :type tile: tuple
+        :returns: None
+        """
+        self.d.set_tile(tile)
+
+    def get_layout(self):
+        """
+        Returns storage of grid coefficients for the 3D curvilinear interior kernels
+
+        :returns: Grid coefficient layout (``'lean'`` or ``'precomputed'``)
+        :rtype: str
+        """
+        return self.d.get_layout()
+
+    def set_layout(self, layout):
+        """
+        Sets storage of grid coefficients for the 3D curvilinear interior kernels
+
+        Options are ``'lean'`` (default), which uses the metric and Jacobian directly, or ``'precomputed'``,
+        which stores the product of the Jacobian and metric and the metric scaled by the material properties
+        at each grid point. The precomputed layout uses additional memory (the code prints the memory used
+        when the simulation starts) and changes results only at the level of floating point roundoff.
+
+        :param layout: New grid coefficient layout
+        :type layout: str
+        :returns: None
+        """
+        self.d.set_layout(layout)
+
+    def get_stage(self):
+        """
+        Returns execution of Runge-Kutta stages
+
+        :returns: Runge-Kutta stage execution (``'separate'`` or ``'fused'``)
+        :rtype: str
+        """
+        return self.d.get_stage()
+
+    def set_stage(self, stage):
+        """
+        Sets execution of Runge-Kutta stages
+
+        Options are ``'separate'`` (default), which scales the rates by the Runge-Kutta coefficient and
+        updates the fields in separate passes over the full arrays, or ``'fused'``, which scales the rates
+        as they are computed and updates the fields in each block as soon as the rates are final. For 3D
+        problems using the vectorized kernels, most of the fields are updated tile by tile while the rates
+        are still in cache. This does not change the simulation results.
+
+        :param stage: New Runge-Kutta stage execution
+        :type stage: str
+        :returns: None
+        """
+        self.d.set_stage(stage)
+
     def get_nx(self):
         """
         Returns number of grid points in (nx, ny, nz) format
@@ -967,6 +1134,31 @@ class problem(object):
         """
         self.d.set_plastic_tensor(plastic_tensor)
 
+    def get_plastic_margin(self):
+        """
+        Returns threshold on yield margin used to skip plasticity calculations
+
+        :returns: Yield margin threshold (zero means all points are checked)
+        :rtype: float
+        """
+        return self.d.get_plastic_margin()
+
+    def set_plastic_margin(self, plastic_margin):
+        """
+        Sets threshold on yield margin used to skip plasticity calculations
+
+        Method sets the threshold on the yield margin (yield stress minus shear stress) used to
+        track the points where plasticity must be checked. Points are skipped only if the stresses
+        cannot have changed enough to come within the threshold of the yield surface since they
+        were last checked. Zero (the default) checks all points on every time step. Must be
+        nonnegative.
+
+        :param plastic_margin: New value of yield margin threshold (must be nonnegative)
+        :type plastic_margin: float
+        :returns: None
+        """
+        self.d.set_plastic_margin(plastic_margin)
+
     def get_nifaces(self):
         """
         Returns number of interfaces
@@ -1,10 +1,13 @@
 #include <iostream>
+#include <algorithm>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
 #include <cmath>
+#include <limits>
 #include <cassert>
 #include <string>
+#include <unistd.h>
 #include "block.hpp"
 #include "boundary.hpp"
 #include "cartesian.hpp"
@@ -30,6 +33,10 @@ block::block(const char* filename, const int ndim_in, const int mode_in, const s
     
     double rho_in, lambda_in, g_in, mu_in, c_in, beta_in, eta_in;
     string boundtype[6], boundfile[6];
+    string simd_in = "auto";
+    int tile_in[2] = {0, 0};
+    string layout = "lean";
+    string stage = "separate";
     
     stringstream ss;
     
@@ -104,6 +111,38 @@ block::block(const char* filename, const int ndim_in, const int mode_in, const s
             if (cdiss > 0.) {
                 dissipation = true;
             }
+            // optional instruction set for interior kernels on following line
+            getline(paramfile,line);
+            if (getline(paramfile,line)) {
+                string method;
+                stringstream ssk(line);
+                ssk >> method;
+                if (method.length() > 0 && method[0] != '[') {
+                    simd_in = method;
+                    // optional tile size for 3D interior sweep on following line (0 selects automatically)
+                    if (getline(paramfile,line)) {
+                        stringstream sst(line);
+                        if (!(sst >> tile_in[0] >> tile_in[1])) {
+                            tile_in[0] = 0;
+                            tile_in[1] = 0;
+                        } else if (getline(paramfile,line)) {
+                            // optional grid coefficient layout on following line
+                            stringstream ssl(line);
+                            ssl >> layout;
+                            if (layout.length() == 0 || layout[0] == '[') {
+                                layout = "lean";
+                            } else if (getline(paramfile,line)) {
+                                // optional RK stage execution (separate or fused) on following line
+                                stringstream sss(line);
+                                sss >> stage;
+                                if (stage.length() == 0 || stage[0] == '[') {
+                                    stage = "separate";
+                                }
+                            }
+                        }
+                    }
+                }
+            }
         }
     } else {
         cerr << "Error opening input file in block.cpp\n";
@@ -132,7 +171,7 @@ block::block(const char* filename, const int ndim_in, const int mode_in, const s
 	
     // set block coordinates to appropriate values
     
-    calc_process_info(cart,fd.get_sbporder());
+    calc_process_info(cart);
     
     // set material properties
     
@@ -152,6 +191,22 @@ block::block(const char* filename, const int ndim_in, const int mode_in, const s
         xfact = -1.;
     }
     
+    // blocks are assumed to be curved until the grid is constructed
+    
+    rectilinear = false;
+    
+    for (int i=0; i<3; i++) {
+        rmetric[i] = 0.;
+    }
+    
+    // RK stage execution and the plastic active set are the same for all blocks, so they are set even if the process has no data
+    
+    fused = (stage == "fused");
+    active_set = (is_plastic && f.plastic_margin > 0. && !fused);
+    active_limit = 0;
+    active_checked = 0;
+    active_total = 0;
+    
     // if process has data, allocate grid, fields, and boundaries
     
     if (no_data) { return; }
@@ -162,21 +217,43 @@ block::block(const char* filename, const int ndim_in, const int mode_in, const s
     nxd[1] = cart.get_nx_tot(1)*cart.get_nx_tot(2);
     nxd[2] = cart.get_nx_tot(2);
         
+    // with a deep halo, ghost points beyond the stencil width at process boundaries inside the block
+    // are computed redundantly, so they are treated as interior points of the block
+    
+    for (int i=0; i<3; i++) {
+        halo_ext[i][0] = 0;
+        halo_ext[i][1] = 0;
+        if (c.get_xm_loc(i) > c.get_xm(i)) {
+            halo_ext[i][0] = max(c.get_xm_ghost(i)-(fd.get_sbporder()-1),0);
+        }
+        if (c.get_xp_loc(i) < c.get_xp(i)) {
+            halo_ext[i][1] = max(c.get_xp_ghost(i)-(fd.get_sbporder()-1),0);
+        }
+    }
+    
     for (int i=0; i<3; i++) {
         mlb[i] = c.get_xm_loc(i)-cart.get_xm_loc(i)+cart.get_xm_ghost(i);
         if (c.get_xm_loc(i) == c.get_xm(i) && c.get_nx(i) > 1) {
             mc[i] = mlb[i]+2*(fd.get_sbporder()-1);
         } else {
-            mc[i] = mlb[i];
+            mc[i] = mlb[i]-halo_ext[i][0];
         }
         if ((c.get_xp_loc(i) == c.get_xp(i)) && c.get_nx(i) > 1) {
             mrb[i] = mlb[i]+c.get_nx_loc(i)-2*(fd.get_sbporder()-1);
             prb[i] = mrb[i]+2*(fd.get_sbporder()-1);
         } else {
-            mrb[i] = mlb[i]+c.get_nx_loc(i);
-            prb[i] = mrb[i];
+            prb[i] = mlb[i]+c.get_nx_loc(i);
+            mrb[i] = prb[i]+halo_ext[i][1];
         }
     }
+    
+    // points within the ghost cell width of a process boundary need ghost cell data, all others
+    // are interior points that can be computed while ghost cells are exchanged
+    
+    for (int i=0; i<3; i++) {
+        interior_min[i] = min(mlb[i]+c.get_xm_ghost(i)-halo_ext[i][0],prb[i]);
+        interior_max[i] = max(prb[i]-c.get_xp_ghost(i)+halo_ext[i][1],interior_min[i]);
+    }
 
     // create boundary surfaces
 
@@ -245,6 +322,62 @@ block::block(const char* filename, const int ndim_in, const int mode_in, const s
 
     set_grid(surf,f,cart,fd);
 
+    // select finite difference kernel
+
+    set_simd(simd_in);
+    set_tile(tile_in, fd.get_sbporder(), f.hetmat);
+    
+    // precomputed grid coefficients are only used by the vectorized kernels for 3D curvilinear blocks
+    
+    precomputed = (layout == "precomputed" && simd != "scalar");
+    
+    if (precomputed && ndim == 3 && !rectilinear && !no_data) {
+        set_precomputed(f);
+    }
+    
+    if (coords[0] == 0 && coords[1] == 0 && coords[2] == 0) {
+        int id;
+        MPI_Comm_rank(MPI_COMM_WORLD, &id);
+        if (id == 0) {
+            if (simd_in != "auto" && simd_in != simd) {
+                cout << "Interior kernel instruction set " << simd_in << " not available. ";
+            }
+            if (layout != "lean" && layout != "precomputed") {
+                cout << "Unknown grid coefficient layout " << layout << ". Defaulting to lean\n";
+            }
+            if (stage != "separate" && stage != "fused") {
+                cout << "Unknown RK stage execution " << stage << ". Defaulting to separate\n";
+            }
+            if (simd == "scalar") {
+                cout << "Using scalar interior kernels\n";
+            } else if (ndim == 3) {
+                cout << "Using " << simd << " interior kernels with " << tile[0] << " x " << tile[1] << " tiles";
+                if (precomputed) {
+                    cout << " and precomputed grid coefficients";
+                }
+                cout << "\n";
+            } else {
+                cout << "Using " << simd << " interior kernels\n";
+            }
+            if (stage == "fused") {
+                cout << "Using fused RK stages\n";
+            }
+            if (is_plastic && f.plastic_margin > 0.) {
+                if (stage == "fused") {
+                    cout << "Plastic active set is not available with fused RK stages, checking all points\n";
+                } else {
+                    cout << "Checking plasticity only at points within " << f.plastic_margin << " of yielding\n";
+                }
+            }
+        }
+    }
+
+    set_kernel(fd.get_sbporder(), f.hetmat);
+    set_plastic_kernel(f.hetmat);
+    set_active_set(f);
+    
+    set_fused(fd.get_sbporder());
+
     // deallocate surfaces
 
     for (int i=0; i<nbound; i++) {
@@ -257,8 +390,17 @@ block::block(const char* filename, const int ndim_in, const int mode_in, const s
     
     bound = new boundary* [nbound];
 
+    // boundaries also cover ghost points that are computed redundantly with a deep halo
+    
+    coord cb = c;
+    
+    for (int i=0; i<ndim; i++) {
+        cb.set_xm_loc(i,c.get_xm_loc(i)-halo_ext[i][0]);
+        cb.set_nx_loc(i,c.get_nx_loc(i)+halo_ext[i][0]+halo_ext[i][1]);
+    }
+    
     for (int i=0; i<nbound; i++) {
-        bound[i] = new boundary(ndim, mode, material_in, i, boundtype[i], c, dx, f, mat, cart, fd);
+        bound[i] = new boundary(ndim, mode, material_in, i, boundtype[i], cb, dx, rectilinear, rmetric, f, mat, cart, fd);
     }
 
 }
@@ -274,6 +416,10 @@ block::~block() {
 	
     delete[] bound;
     
+    if (active_set) {
+        delete[] active_limit;
+    }
+    
 }
 
 int block::get_nx(const int index) const {
@@ -365,6 +511,51 @@ double block::get_l(const int index) const {
     return l_block[index];
 }
 
+bool block::get_rectilinear() const {
+    // returns boolean indicating if block is rectilinear (metric is diagonal and constant)
+    
+    return rectilinear;
+}
+
+double block::get_rmetric(const int index) const {
+    // returns constant metric derivative for a rectilinear block in specified direction
+    assert(index >=0 && index < 3);
+    
+    return rmetric[index];
+}
+
+bool block::get_fused() const {
+    // returns boolean indicating if RK stages are fused (df scaled as it is computed and fields updated by block)
+    
+    return fused;
+}
+
+bool block::get_active_set() const {
+    // returns boolean indicating if plasticity is only checked for points near the yield surface
+    
+    return active_set;
+}
+
+long block::get_active_checked() const {
+    // returns number of points where plasticity was checked in the last time step
+    
+    return active_checked;
+}
+
+long block::get_active_total() const {
+    // returns total number of points where plasticity has been checked
+    
+    return active_total;
+}
+
+long block::get_plastic_points() const {
+    // returns number of points in this block on the local process where plasticity is solved
+    
+    if (no_data || !is_plastic) { return 0; }
+    
+    return (long)(prb[0]-mlb[0])*(long)(prb[1]-mlb[1])*(long)(prb[2]-mlb[2]);
+}
+
 double block::get_min_dx(fields& f) const {
     // returns minimum value of the grid spacing divided by the wave speed
     
@@ -381,8 +572,13 @@ double block::get_min_dx(fields& f) const {
                 index = i*nxd[1]+j*nxd[2]+k;
                 for (int l=0; l<ndim; l++) {
                     dxtest = 0.;
-                    for (int m=0; m<ndim; m++) {
-                        dxtest += pow(f.metric[l*ndim*nxd[0]+m*nxd[0]+index],2);
+                    if (rectilinear) {
+                        // exact metric, may differ in the last bits from the differentiated metric of curvilinear blocks
+                        dxtest = pow(rmetric[l],2);
+                    } else {
+                        for (int m=0; m<ndim; m++) {
+                            dxtest += pow(f.metric[l*ndim*nxd[0]+m*nxd[0]+index],2);
+                        }
                     }
                     if (f.hetmat) {
                         cs = sqrt(f.mat[2*nxd[0]+index]/f.mat[index]);
@@ -402,308 +598,1132 @@ double block::get_min_dx(fields& f) const {
 
 }
 
-void block::calc_df(const double dt, fields& f, const fd_type& fd) {
+void block::calc_df(const double dt, const double A, fields& f, const fd_type& fd, timer& tm) {
     // does first part of a low storage time step
+    // df is scaled by RK coefficient A as it is computed
+    
+    calc_df_interior(dt,A,0.,f,fd,tm);
+    calc_df_edges(dt,A,f,fd,0,tm);
+    
+}
+
+void block::calc_df_interior(const double dt, const double A, const double B, fields& f, const fd_type& fd, timer& tm) {
+    // does first part of a low storage time step for points whose stencils do not include ghost cells
+    // can be called while ghost cells are being exchanged
+    // df is scaled by RK coefficient A as it is computed
+    // if B is nonzero, fields in the fused region are also updated with RK coefficient B as soon as they are final
     
     if (no_data) { return; }
-        
-    switch (ndim) {
-        case 3:
-            calc_df_3d(dt,f,fd);
-            break;
-        case 2:
-            switch (mode) {
-                case 2:
-                    calc_df_mode2(dt,f,fd);
-                    if (is_plastic) {
-                        calc_df_szz(dt,f,fd);
-                    }
-                    break;
-                case 3:
-                    calc_df_mode3(dt,f,fd);
+    
+    calc_df_range(dt,A,(fused_tiles) ? B : 0.,f,fd,interior_min,interior_max,tm);
+    
+}
+
+void block::calc_df_edges(const double dt, const double A, fields& f, const fd_type& fd, const int depth, timer& tm) {
+    // does first part of a low storage time step for points whose stencils include ghost cells
+    // must be called after ghost cell exchange is complete
+    // with a deep halo, up to depth ghost layers beyond the block's own points are also computed
+    // points outside the interior are split into 2*ndim non-overlapping slabs (edges)
+    
+    if (no_data) { return; }
+    
+    int lo[3], hi[3], emin[3], emax[3];
+    
+    for (int i=0; i<3; i++) {
+        lo[i] = mlb[i]-min(depth,halo_ext[i][0]);
+        hi[i] = prb[i]+min(depth,halo_ext[i][1]);
+    }
+    
+    for (int i=0; i<ndim; i++) {
+        for (int j=0; j<3; j++) {
+            if (j < i) {
+                emin[j] = interior_min[j];
+                emax[j] = interior_max[j];
+            } else {
+                emin[j] = lo[j];
+                emax[j] = hi[j];
             }
+        }
+        emax[i] = interior_min[i];
+        calc_df_range(dt,A,0.,f,fd,emin,emax,tm);
+        emin[i] = interior_max[i];
+        emax[i] = hi[i];
+        calc_df_range(dt,A,0.,f,fd,emin,emax,tm);
     }
     
 }
 
-void block::set_boundaries(const double dt, fields& f) {
-    // applies boundary conditions to block
+void block::calc_df_range(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3],
+                          timer& tm) {
+    // does first part of a low storage time step for points from pmin to pmax
+    // points that use the interior stencil in all directions are done with the interior kernel (vectorized if selected,
+    // otherwise the scalar kernel restricted to its fixed width central loops), and the remaining points within
+    // the SBP closure rows of a block edge are done separately with the boundary closure kernel
+    // B is passed to the vectorized kernel for fused updates of the interior (zero for no update)
     
-    // only proceed if this process contains data
+    int cmin[3], cmax[3];
+    bool central = true;
     
-    if (no_data) { return; }
-
-    for (int i=0; i<nbound; i++) {
-        bound[i]->apply_bcs(dt,f);
+    for (int i=0; i<3; i++) {
+        if (i < ndim) {
+            cmin[i] = max(mc[i],pmin[i]);
+            cmax[i] = min(mrb[i],pmax[i]);
+        } else {
+            cmin[i] = pmin[i];
+            cmax[i] = pmax[i];
+        }
+        if (cmin[i] >= cmax[i]) {
+            central = false;
+        }
     }
-
+    
+    if (!central) {
+        tm.start(timer::df_closure);
+        (this->*calc_df_kernel)(dt,A,f,fd,pmin,pmax);
+        tm.stop(timer::df_closure);
+    } else {
+        tm.start(timer::df_interior);
+        if (calc_df_central == 0) {
+            (this->*calc_df_kernel)(dt,A,f,fd,cmin,cmax);
+        } else {
+            (this->*calc_df_central)(dt,A,B,f,fd,cmin,cmax);
+        }
+        tm.stop(timer::df_interior);
+        tm.start(timer::df_closure);
+        calc_df_closure(dt,A,f,fd,pmin,pmax,cmin,cmax);
+        tm.stop(timer::df_closure);
+    }
+    
+    if (ndim == 2 && mode == 2 && is_plastic) {
+        calc_df_szz(dt,f,fd,pmin,pmax);
+    }
+    
 }
 
-void block::calc_plastic(const double dt, fields& f) {
-    // calculates plastic deformation
+void block::calc_df_closure(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3],
+                            const int cmin[3], const int cmax[3]) {
+    // does first part of a low storage time step for the boundary closure points from pmin to pmax outside of the
+    // interior box from cmin to cmax
+    // points are split into 2*ndim non-overlapping slabs, each of which lies within the SBP closure rows
+    // in at least one direction
     
-    if (no_data || !is_plastic) { return; }
-    
-    plastp s_out, s_in;
-    int index;
-    double k, g;
+    int emin[3], emax[3];
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
-                
-                index = i*nxd[1]+j*nxd[2]+k;
-                
-                // assign appropriate fields to stress tensor
-                
-                switch (ndim) {
-                    case 3:
-                        s_in.sxx = f.f[3*nxd[0]+index];
-                        s_in.sxy = f.f[4*nxd[0]+index];
-                        s_in.sxz = f.f[5*nxd[0]+index];
-                        s_in.syy = f.f[6*nxd[0]+index];
-                        s_in.syz = f.f[7*nxd[0]+index];
-                        s_in.szz = f.f[8*nxd[0]+index];
-                        s_in.lambda = f.f[9*nxd[0]+index];
-                        s_in.gammap = f.f[10*nxd[0]+index];
-                        if (plastic_tensor) {
-                            s_in.epxx = f.f[11*nxd[0]+index];
-                            s_in.epxy = f.f[12*nxd[0]+index];
-                            s_in.epxz = f.f[13*nxd[0]+index];
-                            s_in.epyy = f.f[14*nxd[0]+index];
-                            s_in.epyz = f.f[15*nxd[0]+index];
-                            s_in.epzz = f.f[16*nxd[0]+index];
-                        }
-                        break;
-                    case 2:
-                        switch (mode) {
-                            case 2:
-                                s_in.sxx = f.f[2*nxd[0]+index];
-                                s_in.sxy = f.f[3*nxd[0]+index];
-                                s_in.sxz = 0.;
-                                s_in.syy = f.f[4*nxd[0]+index];
-                                s_in.syz = 0.;
-                                s_in.szz = f.f[5*nxd[0]+index];
-                                s_in.lambda = f.f[6*nxd[0]+index];
-                                s_in.gammap = f.f[7*nxd[0]+index];
-                                if (plastic_tensor) {
-                                    s_in.epxx = f.f[8*nxd[0]+index];
-                                    s_in.epxy = f.f[9*nxd[0]+index];
-                                    s_in.epxz = f.f[10*nxd[0]+index];
-                                    s_in.epyy = f.f[11*nxd[0]+index];
-                                    s_in.epyz = f.f[12*nxd[0]+index];
-                                    s_in.epzz = f.f[13*nxd[0]+index];
-                                }
-                                break;
-                            case 3:
-                                s_in.sxx = f.s0[0];
-                                s_in.sxy = 0.;
-                                s_in.sxz = f.f[1*nxd[0]+index];
-                                s_in.syy = f.s0[3];
-                                s_in.syz = f.f[2*nxd[0]+index];
-                                s_in.szz = f.s0[5];
-                                s_in.lambda = f.f[3*nxd[0]+index];
-                                s_in.gammap = f.f[4*nxd[0]+index];
-                                if (plastic_tensor) {
-                                    s_in.epxx = f.f[5*nxd[0]+index];
-                                    s_in.epxy = f.f[6*nxd[0]+index];
-                                    s_in.epxz = f.f[7*nxd[0]+index];
-                                    s_in.epyy = f.f[8*nxd[0]+index];
-                                    s_in.epyz = f.f[9*nxd[0]+index];
-                                    s_in.epzz = f.f[10*nxd[0]+index];
-                                }
-                                break;
-                        }
-                }
-                
-                if (f.hetmat) {
-                    k = f.mat[nxd[0]+index]+2./3.*f.mat[2*nxd[0]+index];
-                    g = f.mat[2*nxd[0]+index];
-                } else {
-                    k = mat.get_lambda()+2./3.*mat.get_g();
-                    g = mat.get_g();
-                }
-                
-                // solve plasticity equations
-                
-                s_out = plastic_flow(dt, s_in, k, g);
-                
-                // adjust stress values
-                
-                switch (ndim) {
-                    case 3:
-                        f.f[3*nxd[0]+index] = s_out.sxx;
-                        f.f[4*nxd[0]+index] = s_out.sxy;
-                        f.f[5*nxd[0]+index] = s_out.sxz;
-                        f.f[6*nxd[0]+index] = s_out.syy;
-                        f.f[7*nxd[0]+index] = s_out.syz;
-                        f.f[8*nxd[0]+index] = s_out.szz;
-                        f.f[9*nxd[0]+index] = s_out.lambda;
-                        f.f[10*nxd[0]+index] = s_out.gammap;
-                        if (plastic_tensor) {
-                            f.f[11*nxd[0]+index] = s_out.epxx;
-                            f.f[12*nxd[0]+index] = s_out.epxy;
-                            f.f[13*nxd[0]+index] = s_out.epxz;
-                            f.f[14*nxd[0]+index] = s_out.epyy;
-                            f.f[15*nxd[0]+index] = s_out.epyz;
-                            f.f[16*nxd[0]+index] = s_out.epzz;
-                        }
-                        break;
-                    case 2:
-                        switch (mode) {
-                            case 2:
-                                f.f[2*nxd[0]+index] = s_out.sxx;
-                                f.f[3*nxd[0]+index] = s_out.sxy;
-                                f.f[4*nxd[0]+index] = s_out.syy;
-                                f.f[5*nxd[0]+index] = s_out.szz;
-                                f.f[6*nxd[0]+index] = s_out.lambda;
-                                f.f[7*nxd[0]+index] = s_out.gammap;
-                                if (plastic_tensor) {
-                                    f.f[8*nxd[0]+index] = s_out.epxx;
-                                    f.f[9*nxd[0]+index] = s_out.epxy;
-                                    f.f[10*nxd[0]+index] = s_out.epxz;
-                                    f.f[11*nxd[0]+index] = s_out.epyy;
-                                    f.f[12*nxd[0]+index] = s_out.epyz;
-                                    f.f[13*nxd[0]+index] = s_out.epzz;
-                                }
-                                break;
-                            case 3:
-                                f.f[1*nxd[0]+index] = s_out.sxz;
-                                f.f[2*nxd[0]+index] = s_out.syz;
-                                f.f[3*nxd[0]+index] = s_out.lambda;
-                                f.f[4*nxd[0]+index] = s_out.gammap;
-                                if (plastic_tensor) {
-                                    f.f[5*nxd[0]+index] = s_out.epxx;
-                                    f.f[6*nxd[0]+index] = s_out.epxy;
-                                    f.f[7*nxd[0]+index] = s_out.epxz;
-                                    f.f[8*nxd[0]+index] = s_out.epyy;
-                                    f.f[9*nxd[0]+index] = s_out.epyz;
-                                    f.f[10*nxd[0]+index] = s_out.epzz;
-                                }
-                                break;
-                        }
-                }
+    for (int i=0; i<ndim; i++) {
+        for (int j=0; j<3; j++) {
+            if (j < i) {
+                emin[j] = cmin[j];
+                emax[j] = cmax[j];
+            } else {
+                emin[j] = pmin[j];
+                emax[j] = pmax[j];
             }
         }
+        emax[i] = cmin[i];
+        if (emin[i] < emax[i]) {
+            (this->*calc_df_kernel)(dt,A,f,fd,emin,emax);
+        }
+        emin[i] = cmax[i];
+        emax[i] = pmax[i];
+        if (emin[i] < emax[i]) {
+            (this->*calc_df_kernel)(dt,A,f,fd,emin,emax);
+        }
     }
+    
 }
 
-plastp block::plastic_flow(const double dt, const plastp s_in, const double k, const double g) const {
-    // solves for stresses and plastic strain
+void block::update(const double B, fields& f, const int depth) {
+    // does second part of a low storage time step (updates fields) for a fused RK stage
+    // covers all points whose df was computed during this stage, except for the fused region of the interior,
+    // which was already updated tile by tile when df was computed
+    // must be called after boundary and interface conditions have been applied
     
-    // calculate shear and normal stresses
+    if (no_data) { return; }
     
-    double sigma = calc_sigma(s_in);
-    double tau = calc_tau(s_in);
+    f.wait_shared();
     
-    // determine if stress exceeds yield stress
+    int lo[3], hi[3], emin[3], emax[3];
     
-    double y = yield(tau, sigma);
+    for (int i=0; i<3; i++) {
+        lo[i] = mlb[i]-min(depth,halo_ext[i][0]);
+        hi[i] = prb[i]+min(depth,halo_ext[i][1]);
+    }
     
-    plastp s_out;
+    if (!fused_tiles) {
+        update_range(B,f,lo,hi);
+        return;
+    }
     
-    double sd[6];
+    // points outside the fused region are split into 2*ndim non-overlapping slabs
     
-    if (y <= 0.) {
-        
-        // no yielding, return existing stress and set lambda = 0
-        
-        s_out = s_in;
-        s_out.lambda = 0.;
-        
-    } else {
-        
-        // yields, must solve for stresses, lambda, and gammap
-        
-        // solve for lambda
-        
-        if (tau*mat.get_mu()*mat.get_beta()*k > (mat.get_mu()*sigma-mat.get_c())*g) {
-            s_out.lambda = (tau+mat.get_mu()*sigma-mat.get_c())/(mat.get_eta()+dt*(g+mat.get_mu()*mat.get_beta()*k));
-        } else { // special case
-            s_out.lambda = tau/(mat.get_eta()+dt*g);
-        }
-        
-        // update gammap
-        
-        s_out.gammap = s_in.gammap+dt*s_out.lambda;
-        
-        // calculate deviatoric stress
-        
-        sd[0] = s_in.sxx-sigma;
-        sd[1] = s_in.sxy;
-        sd[2] = s_in.sxz;
-        sd[3] = s_in.syy-sigma;
-        sd[4] = s_in.syz;
-        sd[5] = s_in.szz-sigma;
-        
-        // correct tau and sigma
-        
-        tau -= dt*s_out.lambda*g;
-        sigma -= dt*s_out.lambda*mat.get_beta()*k;
-        
-        // correct deviatoric stress
-        
-        for (int i = 0; i<6; i++) {
-            sd[i] *= tau/(tau+dt*s_out.lambda*g);
+    for (int i=0; i<ndim; i++) {
+        for (int j=0; j<3; j++) {
+            if (j < i) {
+                emin[j] = fused_min[j];
+                emax[j] = fused_max[j];
+            } else {
+                emin[j] = lo[j];
+                emax[j] = hi[j];
+            }
         }
-        
-        // set new stresses from deviatoric stress
-        
-        s_out.sxx = sd[0]+sigma;
-        s_out.sxy = sd[1];
-        s_out.sxz = sd[2];
-        s_out.syy = sd[3]+sigma;
-        s_out.syz = sd[4];
-        s_out.szz = sd[5]+sigma;
-        
-        s_out.epxx = s_in.epxx+dt*s_out.lambda*(sd[0]/(2.*tau)+(mat.get_beta()/3.));
-        s_out.epxy = s_in.epxy+dt*s_out.lambda*(sd[1]/(2.*tau));
-        s_out.epxz = s_in.epxz+dt*s_out.lambda*(sd[2]/(2.*tau));
-        s_out.epyy = s_in.epyy+dt*s_out.lambda*(sd[3]/(2.*tau)+(mat.get_beta()/3.));
-        s_out.epyz = s_in.epyz+dt*s_out.lambda*(sd[4]/(2.*tau));
-        s_out.epzz = s_in.epzz+dt*s_out.lambda*(sd[5]/(2.*tau)+(mat.get_beta()/3.));
+        emax[i] = fused_min[i];
+        update_range(B,f,emin,emax);
+        emin[i] = fused_max[i];
+        emax[i] = hi[i];
+        update_range(B,f,emin,emax);
+    }
     
+}
+
+void block::update_range(const double B, fields& f, const int pmin[3], const int pmax[3]) {
+    // updates fields with RK coefficient B for points from pmin to pmax
+    
+    #pragma omp parallel for collapse(2)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
+            for (int l=0; l<f.nfields; l++) {
+                const int index = l*nxd[0]+i*nxd[1]+j*nxd[2];
+                for (int k=pmin[2]; k<pmax[2]; k++) {
+                    f.f[index+k] += B*f.df[index+k];
+                }
+            }
+        }
     }
     
-    return s_out;
+}
+
+void block::set_kernel(const int sbporder, const bool hetmat) {
+    // selects the specialized version of calc_df for this block
+    // operator order, material heterogeneity, and dissipation are fixed for the whole simulation,
+    // so they are resolved at compile time rather than checked inside the loops
+    
+    switch (sbporder) {
+        case 2:
+            set_kernel_order<2>(hetmat);
+            break;
+        case 3:
+            set_kernel_order<3>(hetmat);
+            break;
+        case 4:
+            set_kernel_order<4>(hetmat);
+    }
     
 }
+
+template <int order>
+void block::set_kernel_order(const bool hetmat) {
+    // selects kernel based on material heterogeneity
     
-double block::calc_tau(const plastp s) const {
-    // returns second invariant of shear stress
+    if (hetmat) {
+        set_kernel_diss<order,true>();
+    } else {
+        set_kernel_diss<order,false>();
+    }
     
-    return sqrt((pow(s.sxx-s.syy,2)+pow(s.syy-s.szz,2)+pow(s.szz-s.sxx,2))/6.+pow(s.sxy,2)+pow(s.sxz,2)+pow(s.syz,2));
+}
 
+template <int order, bool het>
+void block::set_kernel_diss() {
+    // selects kernel based on dissipation
+    
+    if (dissipation) {
+        set_kernel_grid<order,het,true>();
+    } else {
+        set_kernel_grid<order,het,false>();
+    }
+    
 }
 
-double block::calc_sigma(const plastp s) const {
-    // returns mean stress
+template <int order, bool het, bool diss>
+void block::set_kernel_grid() {
+    // selects kernel based on grid geometry
+    // rectilinear blocks use the constant diagonal metric in place of the metric and jacobian arrays
+    
+    if (rectilinear) {
+        set_kernel_kind<order,het,diss,true>();
+    } else {
+        set_kernel_kind<order,het,diss,false>();
+    }
     
-    return (s.sxx+s.syy+s.szz)/3.;
+}
 
+template <int order, bool het, bool diss, bool rect>
+void block::set_kernel_kind() {
+    // selects kernel based on problem type
+    
+    switch (ndim) {
+        case 3:
+            calc_df_kernel = &block::calc_df_3d<order,het,diss,rect>;
+            set_kernel_simd<3,rect,order,het,diss>();
+            break;
+        case 2:
+            switch (mode) {
+                case 2:
+                    calc_df_kernel = &block::calc_df_mode2<order,het,diss,rect>;
+                    set_kernel_simd<2,rect,order,het,diss>();
+                    break;
+                case 3:
+                    calc_df_kernel = &block::calc_df_mode3<order,het,diss,rect>;
+                    set_kernel_simd<1,rect,order,het,diss>();
+            }
+    }
+    
 }
 
-double block::yield(const double tau, const double sigma) const {
-    // returns yield function given stresses
+void block::set_simd(const string simd_in) {
+    // selects instruction set for vectorized interior kernels
+    // auto picks the widest vector instructions supported by this CPU, scalar uses the original kernels everywhere
     
-    double yf = mat.get_c()-mat.get_mu()*sigma;
+    string best = "sse2";
     
-    if (yf < 0.) {
-        yf = 0.;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        best = "avx512";
+    } else if (__builtin_cpu_supports("avx2")) {
+        best = "avx2";
+    }
+#endif
+    
+    if (simd_in == "scalar" || simd_in == "sse2") {
+        simd = simd_in;
+    } else if (simd_in == "avx2" && (best == "avx2" || best == "avx512")) {
+        simd = simd_in;
+    } else if (simd_in == "avx512" && best == "avx512") {
+        simd = simd_in;
+    } else {
+        simd = best;
     }
     
-    return tau-yf;
-
 }
 
-void block::calc_process_info(const cartesian& cart, const int sbporder) {
-    // calculate local process-specific information
-
-    // store values to save some typing
+void block::set_tile(const int tile_in[2], const int sbporder, const bool hetmat) {
+    // sets tile size in (x,y) for the fused 3D interior sweep, each tile is swept along the full z extent
+    // if not specified, tiles are as long as the block in x and the y size is chosen so that the lines
+    // needed for the x derivative stencil fit in half of the L2 cache
+    
+    for (int i=0; i<2; i++) {
+        if (tile_in[i] < 0) {
+            cerr << "Error in block.cpp: tile size must be nonnegative\n";
+            MPI_Abort(MPI_COMM_WORLD,-1);
+        }
+    }
+    
+    if (tile_in[0] > 0) {
+        tile[0] = tile_in[0];
+    } else {
+        tile[0] = max(c.get_nx_loc(0),1);
+    }
+    
+    if (tile_in[1] > 0) {
+        tile[1] = tile_in[1];
+    } else {
+        long cache = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        cache = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        if (cache <= 0) {
+            cache = 1048576;
+        }
+        
+        // arrays read with the x stencil: fields, plus Jacobian and metric if curvilinear, plus material if heterogeneous
+        
+        int narrays = 9;
+        if (!rectilinear) {
+            narrays += 10;
+        }
+        if (hetmat) {
+            narrays += 3;
+        }
+        
+        const long linesize = (long)narrays*(long)(2*sbporder-1)*(long)max(c.get_nx_loc(2),1)*(long)sizeof(double);
+        tile[1] = (int)min((long)max(c.get_nx_loc(1),1),max(cache/2/linesize,(long)1));
+    }
+    
+}
 
-    int xm_loc_d[3], nx_loc_d[3];
+void block::set_fused(const int sbporder) {
+    // sets region of the interior whose fields are updated tile by tile during a fused RK stage
+    // fields there can only be updated once no other calculation in the stage reads them, so the region excludes
+    // points within the interior stencil width of the boundary closure points and of points near process boundaries,
+    // and points sent to neighboring processes
+    // only the 3D vectorized kernels sweep through the interior in tiles, so other blocks update all points afterwards
+    
+    fused_tiles = (fused && ndim == 3 && simd != "scalar" && !no_data);
+    
+    for (int i=0; i<3; i++) {
+        fused_min[i] = max(max(mc[i],interior_min[i])+sbporder-1,mlb[i]+c.get_xm_ghost(i));
+        fused_max[i] = min(min(mrb[i],interior_max[i])-sbporder+1,prb[i]-c.get_xp_ghost(i));
+        if (fused_min[i] >= fused_max[i]) {
+            fused_tiles = false;
+        }
+    }
+    
+}
 
-    int xm[3], xp[3], nx[3];
+void block::set_precomputed(fields& f) {
+    // sets precomputed grid coefficients for points in this block for the 3D curvilinear interior kernel
+    // metric is scaled by (2G+lambda)/dx, lambda/dx, and G/dx for each direction so that the time step
+    // is the only factor applied in the kernel, the jacobian times the metric is set once the grid is exchanged
+    
+    f.allocate_precomputed();
+    
+    const int n0 = nxd[0];
+    double lambda = mat.get_lambda();
+    double g = mat.get_g();
+    
+    for (int i=mlb[0]; i<prb[0]; i++) {
+        for (int j=mlb[1]; j<prb[1]; j++) {
+            for (int k=mlb[2]; k<prb[2]; k++) {
+                const int index = i*nxd[1]+j*nxd[2]+k;
+                if (f.hetmat) {
+                    lambda = f.mat[n0+index];
+                    g = f.mat[2*n0+index];
+                }
+                for (int d=0; d<3; d++) {
+                    for (int r=0; r<3; r++) {
+                        const int m = 3*d+r;
+                        f.smetric[m*n0+index] = (2.*g+lambda)/dx[d]*f.metric[m*n0+index];
+                        f.smetric[(9+m)*n0+index] = lambda/dx[d]*f.metric[m*n0+index];
+                        f.smetric[(18+m)*n0+index] = g/dx[d]*f.metric[m*n0+index];
+                    }
+                }
+            }
+        }
+    }
+    
+}
+
+template <int kind, bool rect, int order, bool het, bool diss>
+void block::set_kernel_simd() {
+    // selects vectorized interior kernel for the chosen instruction set
+    // kind is the number of fields updated by the kernel (1 for mode 3, 2 for mode 2, 3 for 3d problems)
+    
+    if (simd == "scalar") {
+        calc_df_central = 0;
+        return;
+    }
+    
+    // precomputed grid coefficients are only used for 3D curvilinear blocks
+    
+    const bool pre = (kind == 3 && !rect);
+    
+    if (precomputed && pre) {
+        calc_df_central = &block::calc_df_central_sse2<kind,rect,order,het,diss,pre>;
+    } else {
+        calc_df_central = &block::calc_df_central_sse2<kind,rect,order,het,diss,false>;
+    }
+    
+#if defined(__x86_64__) || defined(__i386__)
+    if (simd == "avx2") {
+        if (precomputed && pre) {
+            calc_df_central = &block::calc_df_central_avx2<kind,rect,order,het,diss,pre>;
+        } else {
+            calc_df_central = &block::calc_df_central_avx2<kind,rect,order,het,diss,false>;
+        }
+    } else if (simd == "avx512") {
+        if (precomputed && pre) {
+            calc_df_central = &block::calc_df_central_avx512<kind,rect,order,het,diss,pre>;
+        } else {
+            calc_df_central = &block::calc_df_central_avx512<kind,rect,order,het,diss,false>;
+        }
+    }
+#endif
+    
+}
+
+template <int kind, bool rect, int order>
+void block::set_central_coeff(const double dt, const fd_type& fd, double* fdc, double* dc, double* coef) const {
+    // sets interior stencil and homogeneous material coefficients for each direction for the vectorized kernels
+    // coefficients are computed exactly as in the scalar kernels (calc_df_rect for rectilinear blocks), and
+    // terms are grouped the same way in both, so the choice of kernel does not change results
+    // coef holds invrho, g2lam, g, lambda, and (for rectilinear blocks) the metric factor for each direction
+    
+    for (int n=0; n<2*order-1; n++) {
+        fdc[n] = fd.fdcoeff[0][n];
+        dc[n] = fd.disscoeff[0][n];
+    }
+    
+    if (rect) {
+        for (int d=0; d<ndim; d++) {
+            const double h = dt*rmetric[d]/dx[d];
+            coef[5*d] = h/mat.get_rho();
+            coef[5*d+1] = h*(2.*mat.get_g()+mat.get_lambda());
+            coef[5*d+2] = h*mat.get_g();
+            coef[5*d+3] = h*mat.get_lambda();
+            coef[5*d+4] = h;
+        }
+    } else {
+        coef[0] = dt/mat.get_rho()/dx[0];
+        coef[1] = dt*(2.*mat.get_g()+mat.get_lambda())/dx[0];
+        coef[2] = dt*mat.get_g()/dx[0];
+        coef[3] = dt*mat.get_lambda()/dx[0];
+        coef[4] = 0.;
+        for (int d=1; d<ndim; d++) {
+            for (int n=0; n<4; n++) {
+                coef[5*d+n] = coef[5*(d-1)+n];
+                coef[5*d+n] *= dx[d-1]/dx[d];
+            }
+            coef[5*d+4] = 0.;
+        }
+    }
+    
+}
+
+template <int kind, bool rect, int order, bool het, bool diss, bool pre>
+inline __attribute__((always_inline)) void block::calc_df_central_line(const double dt, const double A, fields& f, const int i, const int j,
+                                                                      const int lmin, const int lmax, const double* fdc,
+                                                                      const double* dc, const double* coef) {
+    // updates df for a line of points along the last (contiguous) index using the interior stencil in all directions
+    // each point is updated with the same sequence of operations as the scalar kernels (all x terms, then y terms,
+    // then z terms), so results are identical, but the loop over the line is vectorized
+    // always inlined so that it is compiled for the instruction set of the calling kernel
+    
+    const int base = (kind == 3) ? i*nxd[1]+j*nxd[2] : i*nxd[1];
+    
+    calc_df_central_dir<kind,rect,order,het,diss,pre,0>(dt,A,f,base,lmin,lmax,fdc,dc,coef);
+    calc_df_central_dir<kind,rect,order,het,diss,pre,1>(dt,A,f,base,lmin,lmax,fdc,dc,coef);
+    if (kind == 3) {
+        calc_df_central_dir<kind,rect,order,het,diss,pre,2>(dt,A,f,base,lmin,lmax,fdc,dc,coef);
+    }
+    
+}
+
+template <int kind, bool rect, int order, bool het, bool diss, bool pre, int d>
+inline __attribute__((always_inline)) void block::calc_df_central_dir(const double dt, const double A, fields& f, const int base,
+                                                                     const int lmin, const int lmax, const double* fdc,
+                                                                     const double* dc, const double* coef) {
+    // adds terms for derivatives in direction d to df for a line of points using the interior stencil
+    // direction is a template parameter so that the loop over the line has no branches and can be vectorized
+    // inner loops over the stencil and fields are fully unrolled so that the loop over the line is the one vectorized
+    
+    double* df = f.df;
+    const fieldreal* fv = f.f;
+    const double* fm = f.mat;
+    const double* fmd = f.matd;
+    const gridreal* jac = f.jac;
+    const gridreal* metric = f.metric;
+    const gridreal* jm = f.jmetric;
+    const gridreal* sm = f.smetric;
+    const int n0 = nxd[0];
+    const int nd = (kind == 3) ? 3 : 2;
+    const int nf = (kind == 3) ? 9 : ((kind == 2) ? 5 : 3);
+    const double cd = cdiss;
+    const double hd = dt/dx[d];
+    const int stride = (d == 0) ? nxd[1] : ((kind == 3 && d == 1) ? nxd[2] : 1);
+    
+    #pragma omp simd
+    for (int l=lmin; l<lmax; l++) {
+        const int index1 = base+l;
+        const int m = d*nd;
+        if (d == 0) {
+            // scale df by RK coefficient before adding the first terms
+            #pragma GCC unroll 16
+            for (int c=0; c<nf; c++) {
+                df[c*n0+index1] *= A;
+            }
+        }
+        double invrho = coef[5*d], g2lam = coef[5*d+1], g = coef[5*d+2], lambda = coef[5*d+3];
+        if (het) {
+            if (rect) {
+                const double h = coef[5*d+4];
+                invrho = h*fmd[index1];
+                if (kind == 1) {
+                    g = h*fm[n0+index1];
+                } else {
+                    g2lam = h*fmd[n0+index1];
+                    g = h*fm[2*n0+index1];
+                    lambda = h*fm[n0+index1];
+                }
+            } else {
+                invrho = hd*fmd[index1];
+                if (kind == 1) {
+                    g = hd*fm[n0+index1];
+                } else {
+                    g2lam = hd*fmd[n0+index1];
+                    g = hd*fm[2*n0+index1];
+                    lambda = hd*fm[n0+index1];
+                }
+            }
+        }
+        if (rect) {
+            // rectilinear blocks, sum stencil for each derivative and then scale by material properties
+            if (kind == 3) {
+                // derivatives of velocity components and the tractions on planes normal to direction d
+                const int t1 = (d == 0) ? 3 : ((d == 1) ? 4 : 5);
+                const int t2 = (d == 0) ? 4 : ((d == 1) ? 6 : 7);
+                const int t3 = (d == 0) ? 5 : ((d == 1) ? 7 : 8);
+                double dvx = 0., dvy = 0., dvz = 0., ds1 = 0., ds2 = 0., ds3 = 0.;
+                #pragma GCC unroll 16
+                for (int n=0; n<2*order-1; n++) {
+                    const int index2 = index1+(-order+1+n)*stride;
+                    dvx += fdc[n]*fv[0*n0+index2];
+                    dvy += fdc[n]*fv[1*n0+index2];
+                    dvz += fdc[n]*fv[2*n0+index2];
+                    ds1 += fdc[n]*fv[t1*n0+index2];
+                    ds2 += fdc[n]*fv[t2*n0+index2];
+                    ds3 += fdc[n]*fv[t3*n0+index2];
+                }
+                df[0*n0+index1] += invrho*ds1;
+                df[1*n0+index1] += invrho*ds2;
+                df[2*n0+index1] += invrho*ds3;
+                if (d == 0) {
+                    df[3*n0+index1] += g2lam*dvx;
+                    df[4*n0+index1] += g*dvy;
+                    df[5*n0+index1] += g*dvz;
+                    df[6*n0+index1] += lambda*dvx;
+                    df[8*n0+index1] += lambda*dvx;
+                } else if (d == 1) {
+                    df[3*n0+index1] += lambda*dvy;
+                    df[4*n0+index1] += g*dvx;
+                    df[6*n0+index1] += g2lam*dvy;
+                    df[7*n0+index1] += g*dvz;
+                    df[8*n0+index1] += lambda*dvy;
+                } else {
+                    df[3*n0+index1] += lambda*dvz;
+                    df[5*n0+index1] += g*dvx;
+                    df[6*n0+index1] += lambda*dvz;
+                    df[7*n0+index1] += g*dvy;
+                    df[8*n0+index1] += g2lam*dvz;
+                }
+            } else if (kind == 2) {
+                const int t1 = (d == 0) ? 2 : 3;
+                const int t2 = (d == 0) ? 3 : 4;
+                double dvx = 0., dvy = 0., ds1 = 0., ds2 = 0.;
+                #pragma GCC unroll 16
+                for (int n=0; n<2*order-1; n++) {
+                    const int index2 = index1+(-order+1+n)*stride;
+                    dvx += fdc[n]*fv[0*n0+index2];
+                    dvy += fdc[n]*fv[1*n0+index2];
+                    ds1 += fdc[n]*fv[t1*n0+index2];
+                    ds2 += fdc[n]*fv[t2*n0+index2];
+                }
+                df[0*n0+index1] += invrho*ds1;
+                df[1*n0+index1] += invrho*ds2;
+                if (d == 0) {
+                    df[2*n0+index1] += g2lam*dvx;
+                    df[3*n0+index1] += g*dvy;
+                    df[4*n0+index1] += lambda*dvx;
+                } else {
+                    df[2*n0+index1] += lambda*dvy;
+                    df[3*n0+index1] += g*dvx;
+                    df[4*n0+index1] += g2lam*dvy;
+                }
+            } else {
+                double dvz = 0., ds = 0.;
+                #pragma GCC unroll 16
+                for (int n=0; n<2*order-1; n++) {
+                    const int index2 = index1+(-order+1+n)*stride;
+                    dvz += fdc[n]*fv[0*n0+index2];
+                    ds += fdc[n]*fv[(1+d)*n0+index2];
+                }
+                df[0*n0+index1] += invrho*ds;
+                df[(1+d)*n0+index1] += g*dvz;
+            }
+            if (diss) {
+                #pragma GCC unroll 16
+                for (int c=0; c<nf; c++) {
+                    #pragma GCC unroll 16
+                    for (int n=0; n<2*order-1; n++) {
+                        df[c*n0+index1] += cd*dc[n]*fv[c*n0+index1+(-order+1+n)*stride];
+                    }
+                }
+            }
+        } else if (pre) {
+            // 3D curvilinear blocks with precomputed grid coefficients, jm holds the Jacobian times the metric
+            // and sm holds the metric scaled by (2G+lambda)/dx, lambda/dx, and G/dx at each point
+            const double invjac = invrho/jac[index1];
+            double dvx = 0., dvy = 0., dvz = 0., ds1 = 0., ds2 = 0., ds3 = 0.;
+            #pragma GCC unroll 16
+            for (int n=0; n<2*order-1; n++) {
+                const int index2 = index1+(-order+1+n)*stride;
+                dvx += fdc[n]*fv[index2];
+                dvy += fdc[n]*fv[n0+index2];
+                dvz += fdc[n]*fv[2*n0+index2];
+                ds1 += fdc[n]*(jm[m*n0+index2]*fv[3*n0+index2]+jm[(m+1)*n0+index2]*fv[4*n0+index2]+
+                               jm[(m+2)*n0+index2]*fv[5*n0+index2]);
+                ds2 += fdc[n]*(jm[m*n0+index2]*fv[4*n0+index2]+jm[(m+1)*n0+index2]*fv[6*n0+index2]+
+                               jm[(m+2)*n0+index2]*fv[7*n0+index2]);
+                ds3 += fdc[n]*(jm[m*n0+index2]*fv[5*n0+index2]+jm[(m+1)*n0+index2]*fv[7*n0+index2]+
+                               jm[(m+2)*n0+index2]*fv[8*n0+index2]);
+            }
+            df[index1] += invjac*ds1;
+            df[n0+index1] += invjac*ds2;
+            df[2*n0+index1] += invjac*ds3;
+            df[3*n0+index1] += dt*(sm[m*n0+index1]*dvx+sm[(9+m+1)*n0+index1]*dvy+sm[(9+m+2)*n0+index1]*dvz);
+            df[4*n0+index1] += dt*(sm[(18+m)*n0+index1]*dvy+sm[(18+m+1)*n0+index1]*dvx);
+            df[5*n0+index1] += dt*(sm[(18+m)*n0+index1]*dvz+sm[(18+m+2)*n0+index1]*dvx);
+            df[6*n0+index1] += dt*(sm[(9+m)*n0+index1]*dvx+sm[(m+1)*n0+index1]*dvy+sm[(9+m+2)*n0+index1]*dvz);
+            df[7*n0+index1] += dt*(sm[(18+m+1)*n0+index1]*dvz+sm[(18+m+2)*n0+index1]*dvy);
+            df[8*n0+index1] += dt*(sm[(9+m)*n0+index1]*dvx+sm[(9+m+1)*n0+index1]*dvy+sm[(m+2)*n0+index1]*dvz);
+            if (diss) {
+                #pragma GCC unroll 16
+                for (int c=0; c<nf; c++) {
+                    #pragma GCC unroll 16
+                    for (int n=0; n<2*order-1; n++) {
+                        const int index2 = index1+(-order+1+n)*stride;
+                        df[c*n0+index1] += cd*(dc[n]*jac[index2]*fv[c*n0+index2])/jac[index1];
+                    }
+                }
+            }
+        } else {
+            // curvilinear blocks, metric terms for direction d start at m
+            const double invjac = invrho/jac[index1];
+            #pragma GCC unroll 16
+            for (int n=0; n<2*order-1; n++) {
+                const int index2 = index1+(-order+1+n)*stride;
+                if (kind == 3) {
+                    df[0*n0+index1] += (invjac*fdc[n]*jac[index2]*(metric[m*n0+index2]*fv[3*n0+index2]+
+                                                                   metric[(m+1)*n0+index2]*fv[4*n0+index2]+
+                                                                   metric[(m+2)*n0+index2]*fv[5*n0+index2]));
+                    df[1*n0+index1] += (invjac*fdc[n]*jac[index2]*(metric[m*n0+index2]*fv[4*n0+index2]+
+                                                                   metric[(m+1)*n0+index2]*fv[6*n0+index2]+
+                                                                   metric[(m+2)*n0+index2]*fv[7*n0+index2]));
+                    df[2*n0+index1] += (invjac*fdc[n]*jac[index2]*(metric[m*n0+index2]*fv[5*n0+index2]+
+                                                                   metric[(m+1)*n0+index2]*fv[7*n0+index2]+
+                                                                   metric[(m+2)*n0+index2]*fv[8*n0+index2]));
+                    df[3*n0+index1] += fdc[n]*(g2lam*metric[m*n0+index1]*fv[index2]+
+                                               lambda*(metric[(m+1)*n0+index1]*fv[1*n0+index2]+
+                                                       metric[(m+2)*n0+index1]*fv[2*n0+index2]));
+                    df[4*n0+index1] += fdc[n]*g*(metric[m*n0+index1]*fv[1*n0+index2]+
+                                                 metric[(m+1)*n0+index1]*fv[index2]);
+                    df[5*n0+index1] += fdc[n]*g*(metric[m*n0+index1]*fv[2*n0+index2]+
+                                                 metric[(m+2)*n0+index1]*fv[index2]);
+                    df[6*n0+index1] += fdc[n]*(g2lam*metric[(m+1)*n0+index1]*fv[n0+index2]+
+                                               lambda*(metric[m*n0+index1]*fv[index2]+
+                                                       metric[(m+2)*n0+index1]*fv[2*n0+index2]));
+                    df[7*n0+index1] += fdc[n]*g*(metric[(m+1)*n0+index1]*fv[2*n0+index2]+
+                                                 metric[(m+2)*n0+index1]*fv[n0+index2]);
+                    df[8*n0+index1] += fdc[n]*(g2lam*metric[(m+2)*n0+index1]*fv[2*n0+index2]+
+                                               lambda*(metric[m*n0+index1]*fv[index2]+
+                                                       metric[(m+1)*n0+index1]*fv[n0+index2]));
+                } else if (kind == 2) {
+                    df[index1] += (invjac*fdc[n]*jac[index2]*
+                                   (metric[m*n0+index2]*fv[2*n0+index2]+
+                                    metric[(m+1)*n0+index2]*fv[3*n0+index2]));
+                    df[n0+index1] += (invjac*fdc[n]*jac[index2]*
+                                      (metric[m*n0+index2]*fv[3*n0+index2]+
+                                       metric[(m+1)*n0+index2]*fv[4*n0+index2]));
+                    df[2*n0+index1] += fdc[n]*(g2lam*metric[m*n0+index1]*fv[index2]+
+                                               lambda*metric[(m+1)*n0+index1]*fv[n0+index2]);
+                    df[3*n0+index1] += g*fdc[n]*(metric[m*n0+index1]*fv[n0+index2]+
+                                                 metric[(m+1)*n0+index1]*fv[index2]);
+                    df[4*n0+index1] += fdc[n]*(g2lam*metric[(m+1)*n0+index1]*fv[n0+index2]+
+                                               lambda*metric[m*n0+index1]*fv[index2]);
+                } else {
+                    df[index1] += invjac*fdc[n]*jac[index2]*(metric[m*n0+index2]*fv[n0+index2]+
+                                                             metric[(m+1)*n0+index2]*fv[2*n0+index2]);
+                    df[n0+index1] += g*metric[m*n0+index1]*fdc[n]*fv[index2];
+                    df[2*n0+index1] += g*metric[(m+1)*n0+index1]*fdc[n]*fv[index2];
+                }
+                if (diss) {
+                    #pragma GCC unroll 16
+                    for (int c=0; c<nf; c++) {
+                        df[c*n0+index1] += cd*(dc[n]*jac[index2]*fv[c*n0+index2])/jac[index1];
+                    }
+                }
+            }
+        }
+    }
+    
+}
+
+template <int kind, bool rect, int order, bool het, bool diss, bool pre>
+inline __attribute__((always_inline)) void block::calc_df_central_sweep(const double dt, const double A, const double B, fields& f,
+                                                                       const int pmin[3], const int pmax[3], const double* fdc,
+                                                                       const double* dc, const double* coef) {
+    // 3D interior sweep over (i,j) tiles, with all three directions done for each tile so that neighboring lines are
+    // still in cache, must be called by all threads in a parallel region (lines in each tile are split among threads)
+    // for a fused RK stage (B nonzero), fields in the fused region of a tile are updated with RK coefficient B once
+    // the tiles that follow it in each direction are done, as no other points read them after that, and tiles are
+    // at least as wide as the stencil so that only neighboring tiles read from each other
+    // always inlined so that it is compiled for the instruction set of the calling kernel
+    
+    const int tx = (B != 0.) ? max(tile[0],order-1) : tile[0];
+    const int ty = (B != 0.) ? max(tile[1],order-1) : tile[1];
+    const int nty = (pmax[1]-pmin[1]+ty-1)/ty;
+    const int nt = ((pmax[0]-pmin[0]+tx-1)/tx)*nty;
+    const int lag = (nt > nty) ? nty : 1;
+    const int n0 = nxd[0];
+    
+    for (int t=0; t<nt+lag; t++) {
+        if (t < nt) {
+            const int it = pmin[0]+(t/nty)*tx, jt = pmin[1]+(t%nty)*ty;
+            #pragma omp for collapse(2)
+            for (int i=it; i<min(it+tx,pmax[0]); i++) {
+                for (int j=jt; j<min(jt+ty,pmax[1]); j++) {
+                    calc_df_central_line<kind,rect,order,het,diss,pre>(dt,A,f,i,j,pmin[2],pmax[2],fdc,dc,coef);
+                }
+            }
+        }
+        if (B != 0. && t >= lag) {
+            const int it = pmin[0]+((t-lag)/nty)*tx, jt = pmin[1]+((t-lag)%nty)*ty;
+            #pragma omp for collapse(2)
+            for (int i=max(it,fused_min[0]); i<min(min(it+tx,pmax[0]),fused_max[0]); i++) {
+                for (int j=max(jt,fused_min[1]); j<min(min(jt+ty,pmax[1]),fused_max[1]); j++) {
+                    #pragma GCC unroll 16
+                    for (int c=0; c<9; c++) {
+                        fieldreal* fv = f.f+c*n0+i*nxd[1]+j*nxd[2];
+                        const double* df = f.df+c*n0+i*nxd[1]+j*nxd[2];
+                        #pragma omp simd
+                        for (int k=fused_min[2]; k<fused_max[2]; k++) {
+                            fv[k] += B*df[k];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+}
+
+template <int kind, bool rect, int order, bool het, bool diss, bool pre>
+void block::calc_df_central_sse2(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]) {
+    // vectorized interior kernel using the baseline instruction set (SSE2 on x86-64)
+    // in 3D, all three directions are done in a single sweep over (i,j) tiles so that neighboring lines are still in cache
+    // df is scaled by RK coefficient A as it is computed, and if B is nonzero fields are updated tile by tile
+    
+    double fdc[2*order-1], dc[2*order-1], coef[15];
+    
+    set_central_coeff<kind,rect,order>(dt,fd,fdc,dc,coef);
+    
+    if (kind == 3) {
+        #pragma omp parallel
+        calc_df_central_sweep<kind,rect,order,het,diss,pre>(dt,A,B,f,pmin,pmax,fdc,dc,coef);
+    } else {
+        #pragma omp parallel for
+        for (int i=pmin[0]; i<pmax[0]; i++) {
+            calc_df_central_line<kind,rect,order,het,diss,pre>(dt,A,f,i,0,pmin[1],pmax[1],fdc,dc,coef);
+        }
+    }
+    
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+template <int kind, bool rect, int order, bool het, bool diss, bool pre>
+__attribute__((target("avx2"),optimize("fp-contract=off"))) void block::calc_df_central_avx2(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]) {
+    // vectorized interior kernel using AVX2 instructions
+    // floating point contraction is disabled so that fused multiply-adds do not change results relative to the scalar kernels
+    
+    double fdc[2*order-1], dc[2*order-1], coef[15];
+    
+    set_central_coeff<kind,rect,order>(dt,fd,fdc,dc,coef);
+    
+    if (kind == 3) {
+        #pragma omp parallel
+        calc_df_central_sweep<kind,rect,order,het,diss,pre>(dt,A,B,f,pmin,pmax,fdc,dc,coef);
+    } else {
+        #pragma omp parallel for
+        for (int i=pmin[0]; i<pmax[0]; i++) {
+            calc_df_central_line<kind,rect,order,het,diss,pre>(dt,A,f,i,0,pmin[1],pmax[1],fdc,dc,coef);
+        }
+    }
+    
+}
+
+template <int kind, bool rect, int order, bool het, bool diss, bool pre>
+__attribute__((target("avx512f"),optimize("fp-contract=off"))) void block::calc_df_central_avx512(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]) {
+    // vectorized interior kernel using AVX-512 instructions
+    // floating point contraction is disabled so that fused multiply-adds do not change results relative to the scalar kernels
+    
+    double fdc[2*order-1], dc[2*order-1], coef[15];
+    
+    set_central_coeff<kind,rect,order>(dt,fd,fdc,dc,coef);
+    
+    if (kind == 3) {
+        #pragma omp parallel
+        calc_df_central_sweep<kind,rect,order,het,diss,pre>(dt,A,B,f,pmin,pmax,fdc,dc,coef);
+    } else {
+        #pragma omp parallel for
+        for (int i=pmin[0]; i<pmax[0]; i++) {
+            calc_df_central_line<kind,rect,order,het,diss,pre>(dt,A,f,i,0,pmin[1],pmax[1],fdc,dc,coef);
+        }
+    }
+    
+}
+
+#endif
+
+void block::set_boundaries(const double dt, fields& f) {
+    // applies boundary conditions to block
+    
+    // only proceed if this process contains data
+    
+    if (no_data) { return; }
+
+    for (int i=0; i<nbound; i++) {
+        bound[i]->apply_bcs(dt,f);
+    }
+
+}
+
+void block::calc_plastic(const double dt, fields& f) {
+    // calculates plastic deformation using the return mapping kernel selected for this block
+    
+    if (no_data || !is_plastic) { return; }
+    
+    (this->*calc_plastic_kernel)(dt,f);
+    
+}
+
+void block::set_plastic_kernel(const bool hetmat) {
+    // selects the specialized version of the plasticity kernel for this block
+    // problem type, plastic strain output, and material heterogeneity are resolved at compile time
+    
+    calc_plastic_kernel = 0;
+    
+    if (!is_plastic) { return; }
+    
+    switch (ndim) {
+        case 3:
+            set_plastic_kernel_kind<3>(hetmat);
+            break;
+        case 2:
+            switch (mode) {
+                case 2:
+                    set_plastic_kernel_kind<2>(hetmat);
+                    break;
+                case 3:
+                    set_plastic_kernel_kind<1>(hetmat);
+            }
+    }
+    
+}
+
+void block::set_active_set(fields& f) {
+    // sets up the plastic active set, which skips lines of points whose yield margin is large enough that they
+    // cannot reach the yield surface with the stress changes accumulated since they were last checked
+    // the bound on stress changes is accumulated when the fields are updated, so this is not used with fused stages
+    // only called if the process has data, as the flag itself is set for all blocks in the constructor
+    
+    active_margin = f.plastic_margin;
+    
+    if (!active_set) { return; }
+    
+    // limits are zero initially, so all points are checked on the first time step
+    
+    const int nlines = (ndim == 3) ? (prb[0]-mlb[0])*(prb[1]-mlb[1]) : prb[0]-mlb[0];
+    
+    active_limit = new double [nlines];
+    
+    for (int i=0; i<nlines; i++) {
+        active_limit[i] = 0.;
+    }
+    
+}
+
+template <int kind>
+void block::set_plastic_kernel_kind(const bool hetmat) {
+    // selects plasticity kernel based on plastic strain output and material heterogeneity
+    
+    if (plastic_tensor) {
+        if (hetmat) {
+            calc_plastic_kernel = &block::calc_plastic_batch<kind,true,true>;
+        } else {
+            calc_plastic_kernel = &block::calc_plastic_batch<kind,true,false>;
+        }
+    } else {
+        if (hetmat) {
+            calc_plastic_kernel = &block::calc_plastic_batch<kind,false,true>;
+        } else {
+            calc_plastic_kernel = &block::calc_plastic_batch<kind,false,false>;
+        }
+    }
+    
+}
+
+template <int kind, bool tensor, bool het>
+void block::calc_plastic_batch(const double dt, fields& f) {
+    // solves for stresses and plastic strain at all points in the block, working directly on the field arrays
+    // the field arrays hold stress changes, so the initial stress is added when loading and removed when storing
+    // kind is 3 for 3D, 2 for mode 2, and 1 for mode 3, where the in-plane stresses are the constant initial values
+    // loops are over lines along the last dimension with data, and the loop along each line is vectorized
+    // each point computes both the yielding and the elastic result and selects one, so there are no branches
+    // with the active set, a line is skipped if its smallest yield margin when last checked, less the largest possible
+    // change in the yield function since then, exceeds the threshold. changes in the mean stress alter the yield
+    // function by at most mu times the change in any stress component, and changes in tau are at most sqrt(5) times
+    
+    fieldreal* fv = f.f;
+    const double* fm = f.mat;
+    const int n0 = nxd[0];
+    
+    // field indices for stress components, lambda, gammap, and plastic strain (unused components are -1)
+    
+    const int ixx = (kind == 3) ? 3 : ((kind == 2) ? 2 : -1);
+    const int ixy = (kind == 3) ? 4 : ((kind == 2) ? 3 : -1);
+    const int ixz = (kind == 3) ? 5 : ((kind == 2) ? -1 : 1);
+    const int iyy = (kind == 3) ? 6 : ((kind == 2) ? 4 : -1);
+    const int iyz = (kind == 3) ? 7 : ((kind == 2) ? -1 : 2);
+    const int izz = (kind == 3) ? 8 : ((kind == 2) ? 5 : -1);
+    const int il = (kind == 3) ? 9 : ((kind == 2) ? 6 : 3);
+    const int igp = il+1;
+    const int iep = il+2;
+    
+    // material properties and initial stress are loaded once rather than for each point
+    
+    const double mu = mat.get_mu();
+    const double beta = mat.get_beta();
+    const double c = mat.get_c();
+    const double eta = mat.get_eta();
+    const double kmat = mat.get_lambda()+2./3.*mat.get_g();
+    const double gmat = mat.get_g();
+    const double sxx0 = f.s0[0];
+    const double sxy0 = f.s0[1];
+    const double sxz0 = f.s0[2];
+    const double syy0 = f.s0[3];
+    const double syz0 = f.s0[4];
+    const double szz0 = f.s0[5];
+    const bool hs = f.hetstress;
+    const double* sh = f.s;
+    const int nv = f.nv;
+    
+    const int jmin = (kind == 3) ? mlb[1] : 0;
+    const int jmax = (kind == 3) ? prb[1] : 1;
+    const int lmin = (kind == 3) ? mlb[2] : mlb[1];
+    const int lmax = (kind == 3) ? prb[2] : prb[1];
+    
+    const double drift = (sqrt(5.)+mu)*f.stress_change;
+    long nchecked = 0;
+    
+    #pragma omp parallel for collapse(2) reduction(+:nchecked)
+    for (int i=mlb[0]; i<prb[0]; i++) {
+        for (int j=jmin; j<jmax; j++) {
+            const int line = (i-mlb[0])*(jmax-jmin)+j-jmin;
+            if (active_set && active_limit[line]-drift > active_margin) { continue; }
+            nchecked += lmax-lmin;
+            const int base = (kind == 3) ? i*nxd[1]+j*nxd[2] : i*nxd[1];
+            double margin = numeric_limits<double>::max();
+            #pragma omp simd reduction(min:margin)
+            for (int l=lmin; l<lmax; l++) {
+                const int index = base+l;
+                
+                // absolute stress is the stored stress change plus the uniform and heterogeneous initial stress
+                
+                const double oxx = (kind == 1) ? 0. : sxx0+((hs) ? sh[(ixx-nv)*n0+index] : 0.);
+                const double oxy = (kind == 1) ? 0. : sxy0+((hs) ? sh[(ixy-nv)*n0+index] : 0.);
+                const double oxz = (kind == 2) ? 0. : sxz0+((hs) ? sh[(ixz-nv)*n0+index] : 0.);
+                const double oyy = (kind == 1) ? 0. : syy0+((hs) ? sh[(iyy-nv)*n0+index] : 0.);
+                const double oyz = (kind == 2) ? 0. : syz0+((hs) ? sh[(iyz-nv)*n0+index] : 0.);
+                const double ozz = (kind == 1) ? 0. : szz0+((hs) ? sh[(izz-nv)*n0+index] : 0.);
+                
+                const double rxx = (kind == 1) ? 0. : fv[ixx*n0+index];
+                const double rxy = (kind == 1) ? 0. : fv[ixy*n0+index];
+                const double rxz = (kind == 2) ? 0. : fv[ixz*n0+index];
+                const double ryy = (kind == 1) ? 0. : fv[iyy*n0+index];
+                const double ryz = (kind == 2) ? 0. : fv[iyz*n0+index];
+                const double rzz = (kind == 1) ? 0. : fv[izz*n0+index];
+                
+                const double sxx = (kind == 1) ? sxx0 : rxx+oxx;
+                const double sxy = (kind == 1) ? 0. : rxy+oxy;
+                const double sxz = (kind == 2) ? 0. : rxz+oxz;
+                const double syy = (kind == 1) ? syy0 : ryy+oyy;
+                const double syz = (kind == 2) ? 0. : ryz+oyz;
+                const double szz = (kind == 1) ? szz0 : rzz+ozz;
+                const double gammap = fv[igp*n0+index];
+                
+                const double k = (het) ? fm[n0+index]+2./3.*fm[2*n0+index] : kmat;
+                const double g = (het) ? fm[2*n0+index] : gmat;
+                
+                // calculate mean stress and second invariant of shear stress and check yield function
+                
+                double sigma = (sxx+syy+szz)/3.;
+                double tau = sqrt(((sxx-syy)*(sxx-syy)+(syy-szz)*(syy-szz)+(szz-sxx)*(szz-sxx))/6.+sxy*sxy+sxz*sxz+syz*syz);
+                
+                double yf = c-mu*sigma;
+                yf = (yf < 0.) ? 0. : yf;
+                const bool yields = (tau-yf > 0.);
+                
+                // yield margin is zero for yielding points so that their line is checked on the next time step
+                
+                const double m = (yields) ? 0. : yf-tau;
+                margin = (m < margin) ? m : margin;
+                
+                // solve for lambda, which is zero if the point does not yield
+                
+                double lambda;
+                
+                if (tau*mu*beta*k > (mu*sigma-c)*g) {
+                    lambda = (tau+mu*sigma-c)/(eta+dt*(g+mu*beta*k));
+                } else { // special case
+                    lambda = tau/(eta+dt*g);
+                }
+                
+                lambda = (yields) ? lambda : 0.;
+                
+                // deviatoric stress
+                
+                double sd[6];
+                
+                sd[0] = sxx-sigma;
+                sd[1] = sxy;
+                sd[2] = sxz;
+                sd[3] = syy-sigma;
+                sd[4] = syz;
+                sd[5] = szz-sigma;
+                
+                // correct tau, sigma, and deviatoric stress
+                
+                tau -= dt*lambda*g;
+                sigma -= dt*lambda*beta*k;
+                
+                const double scale = tau/(tau+dt*lambda*g);
+                
+                for (int n=0; n<6; n++) {
+                    sd[n] *= scale;
+                }
+                
+                // store new stress changes, lambda, and gammap, or the original values if the point does not yield
+                
+                if (kind != 1) {
+                    fv[ixx*n0+index] = (yields) ? sd[0]+sigma-oxx : rxx;
+                    fv[ixy*n0+index] = (yields) ? sd[1]-oxy : rxy;
+                    fv[iyy*n0+index] = (yields) ? sd[3]+sigma-oyy : ryy;
+                    fv[izz*n0+index] = (yields) ? sd[5]+sigma-ozz : rzz;
+                }
+                if (kind != 2) {
+                    fv[ixz*n0+index] = (yields) ? sd[2]-oxz : rxz;
+                    fv[iyz*n0+index] = (yields) ? sd[4]-oyz : ryz;
+                }
+                fv[il*n0+index] = lambda;
+                fv[igp*n0+index] = (yields) ? gammap+dt*lambda : gammap;
+                
+                // update plastic strain
+                
+                if (tensor) {
+                    const double epxx = fv[iep*n0+index];
+                    const double epxy = fv[(iep+1)*n0+index];
+                    const double epxz = fv[(iep+2)*n0+index];
+                    const double epyy = fv[(iep+3)*n0+index];
+                    const double epyz = fv[(iep+4)*n0+index];
+                    const double epzz = fv[(iep+5)*n0+index];
+                    fv[iep*n0+index] = (yields) ? epxx+dt*lambda*(sd[0]/(2.*tau)+(beta/3.)) : epxx;
+                    fv[(iep+1)*n0+index] = (yields) ? epxy+dt*lambda*(sd[1]/(2.*tau)) : epxy;
+                    fv[(iep+2)*n0+index] = (yields) ? epxz+dt*lambda*(sd[2]/(2.*tau)) : epxz;
+                    fv[(iep+3)*n0+index] = (yields) ? epyy+dt*lambda*(sd[3]/(2.*tau)+(beta/3.)) : epyy;
+                    fv[(iep+4)*n0+index] = (yields) ? epyz+dt*lambda*(sd[4]/(2.*tau)) : epyz;
+                    fv[(iep+5)*n0+index] = (yields) ? epzz+dt*lambda*(sd[5]/(2.*tau)+(beta/3.)) : epzz;
+                }
+            }
+            if (active_set) {
+                active_limit[line] = margin+drift;
+            }
+        }
+    }
+    
+    active_checked = nchecked;
+    active_total += nchecked;
+    
+}
+
+void block::calc_process_info(const cartesian& cart) {
+    // calculate local process-specific information
+
+    // store values to save some typing
+
+    int xm_loc_d[3], nx_loc_d[3];
+
+    int xm[3], xp[3], nx[3];
 
 	for (int i=0; i<ndim; i++) {
 		xm_loc_d[i] = cart.get_xm_loc(i);
@@ -737,13 +1757,13 @@ void block::calc_process_info(const cartesian& cart, const int sbporder) {
     
 	for (int i=0; i<ndim; i++) {
 		if (xm_loc_d[i] > xm[i] && xm_loc_d[i] < xp[i]) {
-			c.set_xm_ghost(i,sbporder-1);
+			c.set_xm_ghost(i,cart.get_xm_ghost(i));
 		} else if (xm_loc_d[i] == xp[i]+1) {
 			c.set_xp_ghost(i,1);
 		}
     
 		if (xm_loc_d[i]+nx_loc_d[i]-1 > xm[i] && xm_loc_d[i]+nx_loc_d[i]-1 < xp[i]) {
-			c.set_xp_ghost(i,sbporder-1);
+			c.set_xp_ghost(i,cart.get_xp_ghost(i));
 		} else if (xm_loc_d[i]+nx_loc_d[i]-1 == xm[i]-1) {
 			c.set_xm_ghost(i,1);
 		}
@@ -828,6 +1848,26 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
         }
     }
     
+    // if block is rectilinear, metric is diagonal and constant and jacobian is uniform
+    // so neither is computed or stored (kernels use rmetric instead)
+    
+    rectilinear = check_rectilinear(surf);
+    
+    if (rectilinear) { return; }
+    
+    f.allocate_metric();
+    
+    // metric is also computed at ghost points that are computed redundantly with a deep halo
+    // these are always interior points of the block
+    
+    int lo[3], hi[3], nloc[3];
+    
+    for (int i=0; i<3; i++) {
+        lo[i] = mlb[i]-halo_ext[i][0];
+        hi[i] = prb[i]+halo_ext[i][1];
+        nloc[i] = hi[i]-lo[i];
+    }
+    
     // calculate metric derivatives
     // if 2d problem, set appropriate values for z derivatives to give correct 2d result
     
@@ -841,23 +1881,23 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
-            xp[i][j] = new double** [c.get_nx_loc(0)];
+            xp[i][j] = new double** [nloc[0]];
         }
     }
     
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
-            for (int k=0; k<c.get_nx_loc(0); k++) {
-                xp[i][j][k] = new double* [c.get_nx_loc(1)];
+            for (int k=0; k<nloc[0]; k++) {
+                xp[i][j][k] = new double* [nloc[1]];
             }
         }
     }
     
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
-            for (int k=0; k<c.get_nx_loc(0); k++) {
-                for (int l=0; l<c.get_nx_loc(1); l++) {
-                    xp[i][j][k][l] = new double [c.get_nx_loc(2)];
+            for (int k=0; k<nloc[0]; k++) {
+                for (int l=0; l<nloc[1]; l++) {
+                    xp[i][j][k][l] = new double [nloc[2]];
                 }
             }
         }
@@ -865,9 +1905,9 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
-            for (int k=0; k<c.get_nx_loc(0); k++) {
-                for (int l=0; l<c.get_nx_loc(1); l++) {
-                    for (int m=0; m<c.get_nx_loc(2); m++) {
+            for (int k=0; k<nloc[0]; k++) {
+                for (int l=0; l<nloc[1]; l++) {
+                    for (int m=0; m<nloc[2]; m++) {
                         if (i == j) {
                             xp[i][j][k][l][m] = 1.;
                         } else {
@@ -881,32 +1921,32 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     // x derivatives
     
-    for (int j=mlb[1]; j<prb[1]; j++) {
-        for (int k=mlb[2]; k<prb[2]; k++) {
-            for (int i=mlb[0]; i<mc[0]; i++) {
+    for (int j=lo[1]; j<hi[1]; j++) {
+        for (int k=lo[2]; k<hi[2]; k++) {
+            for (int i=lo[0]; i<mc[0]; i++) {
                 // left boundaries
                 for (int l=0; l<ndim; l++) {
-                    xp[l][0][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                    xp[l][0][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                     for (int n=0; n<3*(fd.sbporder-1); n++) {
-                        xp[l][0][i-mlb[0]][j-mlb[1]][k-mlb[2]] += fd.fdcoeff[i-mlb[0]+1][n]*f.x[l*nxd[0]+(mlb[0]+n)*nxd[1]+j*nxd[2]+k]/dx[0];
+                        xp[l][0][i-lo[0]][j-lo[1]][k-lo[2]] += fd.fdcoeff[i-mlb[0]+1][n]*f.x[l*nxd[0]+(mlb[0]+n)*nxd[1]+j*nxd[2]+k]/dx[0];
                     }
                 }
             }
             for (int i=mc[0]; i<mrb[0]; i++) {
                 // interior points
                 for (int l=0; l<ndim; l++) {
-                    xp[l][0][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                    xp[l][0][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                     for (int n=0; n<2*fd.sbporder-1; n++) {
-                        xp[l][0][i-mlb[0]][j-mlb[1]][k-mlb[2]] += fd.fdcoeff[0][n]*f.x[l*nxd[0]+(i-fd.sbporder+1+n)*nxd[1]+j*nxd[2]+k]/dx[0];
+                        xp[l][0][i-lo[0]][j-lo[1]][k-lo[2]] += fd.fdcoeff[0][n]*f.x[l*nxd[0]+(i-fd.sbporder+1+n)*nxd[1]+j*nxd[2]+k]/dx[0];
                     }
                 }
             }
-            for (int i=mrb[0]; i<prb[0]; i++) {
+            for (int i=mrb[0]; i<hi[0]; i++) {
                 // right boundaries
                 for (int l=0; l<ndim; l++) {
-                    xp[l][0][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                    xp[l][0][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                     for (int n=0; n<3*(fd.sbporder-1); n++) {
-                        xp[l][0][i-mlb[0]][j-mlb[1]][k-mlb[2]] -= fd.fdcoeff[prb[0]-i][n]*f.x[l*nxd[0]+(prb[0]-1-n)*nxd[1]+j*nxd[2]+k]/dx[0];
+                        xp[l][0][i-lo[0]][j-lo[1]][k-lo[2]] -= fd.fdcoeff[prb[0]-i][n]*f.x[l*nxd[0]+(prb[0]-1-n)*nxd[1]+j*nxd[2]+k]/dx[0];
                     }
                 }
             }
@@ -915,32 +1955,32 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     // y derivatives
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int k=mlb[2]; k<prb[2]; k++) {
-            for (int j=mlb[1]; j<mc[1]; j++) {
+    for (int i=lo[0]; i<hi[0]; i++) {
+        for (int k=lo[2]; k<hi[2]; k++) {
+            for (int j=lo[1]; j<mc[1]; j++) {
                 // left boundaries
                 for (int l=0; l<ndim; l++) {
-                    xp[l][1][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                    xp[l][1][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                     for (int n=0; n<3*(fd.sbporder-1); n++) {
-                        xp[l][1][i-mlb[0]][j-mlb[1]][k-mlb[2]] += fd.fdcoeff[j-mlb[1]+1][n]*f.x[l*nxd[0]+i*nxd[1]+(mlb[1]+n)*nxd[2]+k]/dx[1];
+                        xp[l][1][i-lo[0]][j-lo[1]][k-lo[2]] += fd.fdcoeff[j-mlb[1]+1][n]*f.x[l*nxd[0]+i*nxd[1]+(mlb[1]+n)*nxd[2]+k]/dx[1];
                     }
                 }
             }
             for (int j=mc[1]; j<mrb[1]; j++) {
                 // interior points
                 for (int l=0; l<ndim; l++) {
-                    xp[l][1][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                    xp[l][1][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                     for (int n=0; n<2*fd.sbporder-1; n++) {
-                        xp[l][1][i-mlb[0]][j-mlb[1]][k-mlb[2]] += fd.fdcoeff[0][n]*f.x[l*nxd[0]+i*nxd[1]+(j-fd.sbporder+1+n)*nxd[2]+k]/dx[1];
+                        xp[l][1][i-lo[0]][j-lo[1]][k-lo[2]] += fd.fdcoeff[0][n]*f.x[l*nxd[0]+i*nxd[1]+(j-fd.sbporder+1+n)*nxd[2]+k]/dx[1];
                     }
                 }
             }
-            for (int j=mrb[1]; j<prb[1]; j++) {
+            for (int j=mrb[1]; j<hi[1]; j++) {
                 // right boundaries
                 for (int l=0; l<ndim; l++) {
-                    xp[l][1][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                    xp[l][1][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                     for (int n=0; n<3*(fd.sbporder-1); n++) {
-                        xp[l][1][i-mlb[0]][j-mlb[1]][k-mlb[2]] -= fd.fdcoeff[prb[1]-j][n]*f.x[l*nxd[0]+i*nxd[1]+(prb[1]-1-n)*nxd[2]+k]/dx[1];
+                        xp[l][1][i-lo[0]][j-lo[1]][k-lo[2]] -= fd.fdcoeff[prb[1]-j][n]*f.x[l*nxd[0]+i*nxd[1]+(prb[1]-1-n)*nxd[2]+k]/dx[1];
                     }
                 }
             }
@@ -951,32 +1991,32 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     if (ndim == 3) {
     
-        for (int i=mlb[0]; i<prb[0]; i++) {
-            for (int j=mlb[1]; j<prb[1]; j++) {
-                for (int k=mlb[2]; k<mc[2]; k++) {
+        for (int i=lo[0]; i<hi[0]; i++) {
+            for (int j=lo[1]; j<hi[1]; j++) {
+                for (int k=lo[2]; k<mc[2]; k++) {
                     // left boundaries
                     for (int l=0; l<ndim; l++) {
-                        xp[l][2][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                        xp[l][2][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                         for (int n=0; n<3*(fd.sbporder-1); n++) {
-                            xp[l][2][i-mlb[0]][j-mlb[1]][k-mlb[2]] += fd.fdcoeff[k-mlb[2]+1][n]*f.x[l*nxd[0]+i*nxd[1]+j*nxd[2]+(mlb[2]+n)]/dx[2];
+                            xp[l][2][i-lo[0]][j-lo[1]][k-lo[2]] += fd.fdcoeff[k-mlb[2]+1][n]*f.x[l*nxd[0]+i*nxd[1]+j*nxd[2]+(mlb[2]+n)]/dx[2];
                         }
                     }
                 }
                 for (int k=mc[2]; k<mrb[2]; k++) {
                     // interior points
                     for (int l=0; l<ndim; l++) {
-                        xp[l][2][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                        xp[l][2][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                         for (int n=0; n<2*fd.sbporder-1; n++) {
-                            xp[l][2][i-mlb[0]][j-mlb[1]][k-mlb[2]] += fd.fdcoeff[0][n]*f.x[l*nxd[0]+i*nxd[1]+j*nxd[2]+(k-fd.sbporder+1+n)]/dx[2];
+                            xp[l][2][i-lo[0]][j-lo[1]][k-lo[2]] += fd.fdcoeff[0][n]*f.x[l*nxd[0]+i*nxd[1]+j*nxd[2]+(k-fd.sbporder+1+n)]/dx[2];
                         }
                     }
                 }
-                for (int k=mrb[2]; k<prb[2]; k++) {
+                for (int k=mrb[2]; k<hi[2]; k++) {
                     // right boundaries
                     for (int l=0; l<ndim; l++) {
-                        xp[l][2][i-mlb[0]][j-mlb[1]][k-mlb[2]] = 0.;
+                        xp[l][2][i-lo[0]][j-lo[1]][k-lo[2]] = 0.;
                         for (int n=0; n<3*(fd.sbporder-1); n++) {
-                            xp[l][2][i-mlb[0]][j-mlb[1]][k-mlb[2]] -= fd.fdcoeff[prb[2]-k][n]*f.x[l*nxd[0]+i*nxd[1]+j*nxd[2]+(prb[2]-1-n)]/dx[2];
+                            xp[l][2][i-lo[0]][j-lo[1]][k-lo[2]] -= fd.fdcoeff[prb[2]-k][n]*f.x[l*nxd[0]+i*nxd[1]+j*nxd[2]+(prb[2]-1-n)]/dx[2];
                         }
                     }
                 }
@@ -987,25 +2027,25 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     // calculate metric derivatives and jacobian
                 
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
-                f.jac[i*nxd[1]+j*nxd[2]+k] = (xp[0][0][i-mlb[0]][j-mlb[1]][k-mlb[2]]*
-                                              (xp[1][1][i-mlb[0]][j-mlb[1]][k-mlb[2]]*xp[2][2][i-mlb[0]][j-mlb[1]][k-mlb[2]]-
-                                               xp[1][2][i-mlb[0]][j-mlb[1]][k-mlb[2]]*xp[2][1][i-mlb[0]][j-mlb[1]][k-mlb[2]])-
-                                              xp[1][0][i-mlb[0]][j-mlb[1]][k-mlb[2]]*
-                                              (xp[0][1][i-mlb[0]][j-mlb[1]][k-mlb[2]]*xp[2][2][i-mlb[0]][j-mlb[1]][k-mlb[2]]-
-                                               xp[0][2][i-mlb[0]][j-mlb[1]][k-mlb[2]]*xp[2][1][i-mlb[0]][j-mlb[1]][k-mlb[2]])+
-                                              xp[2][0][i-mlb[0]][j-mlb[1]][k-mlb[2]]*
-                                              (xp[0][1][i-mlb[0]][j-mlb[1]][k-mlb[2]]*xp[1][2][i-mlb[0]][j-mlb[1]][k-mlb[2]]-
-                                               xp[0][2][i-mlb[0]][j-mlb[1]][k-mlb[2]]*xp[1][1][i-mlb[0]][j-mlb[1]][k-mlb[2]]));
+    for (int i=lo[0]; i<hi[0]; i++) {
+        for (int j=lo[1]; j<hi[1]; j++) {
+            for (int k=lo[2]; k<hi[2]; k++) {
+                f.jac[i*nxd[1]+j*nxd[2]+k] = (xp[0][0][i-lo[0]][j-lo[1]][k-lo[2]]*
+                                              (xp[1][1][i-lo[0]][j-lo[1]][k-lo[2]]*xp[2][2][i-lo[0]][j-lo[1]][k-lo[2]]-
+                                               xp[1][2][i-lo[0]][j-lo[1]][k-lo[2]]*xp[2][1][i-lo[0]][j-lo[1]][k-lo[2]])-
+                                              xp[1][0][i-lo[0]][j-lo[1]][k-lo[2]]*
+                                              (xp[0][1][i-lo[0]][j-lo[1]][k-lo[2]]*xp[2][2][i-lo[0]][j-lo[1]][k-lo[2]]-
+                                               xp[0][2][i-lo[0]][j-lo[1]][k-lo[2]]*xp[2][1][i-lo[0]][j-lo[1]][k-lo[2]])+
+                                              xp[2][0][i-lo[0]][j-lo[1]][k-lo[2]]*
+                                              (xp[0][1][i-lo[0]][j-lo[1]][k-lo[2]]*xp[1][2][i-lo[0]][j-lo[1]][k-lo[2]]-
+                                               xp[0][2][i-lo[0]][j-lo[1]][k-lo[2]]*xp[1][1][i-lo[0]][j-lo[1]][k-lo[2]]));
                 assert(f.jac[i*nxd[1]+j*nxd[2]+k] > 0.);  // jacobian must be positive, otherwise grid is not smooth enough
                 for (int l=0; l<ndim; l++) {
                     for (int m=0; m<ndim; m++) {
-                        f.metric[l*ndim*nxd[0]+m*nxd[0]+i*nxd[1]+j*nxd[2]+k] = ((xp[(m+1)%3][(l+1)%3][i-mlb[0]][j-mlb[1]][k-mlb[2]]*
-                                                                                xp[(m+2)%3][(l+2)%3][i-mlb[0]][j-mlb[1]][k-mlb[2]]-
-                                                                                xp[(m+1)%3][(l+2)%3][i-mlb[0]][j-mlb[1]][k-mlb[2]]*
-                                                                                xp[(m+2)%3][(l+1)%3][i-mlb[0]][j-mlb[1]][k-mlb[2]])/
+                        f.metric[l*ndim*nxd[0]+m*nxd[0]+i*nxd[1]+j*nxd[2]+k] = ((xp[(m+1)%3][(l+1)%3][i-lo[0]][j-lo[1]][k-lo[2]]*
+                                                                                xp[(m+2)%3][(l+2)%3][i-lo[0]][j-lo[1]][k-lo[2]]-
+                                                                                xp[(m+1)%3][(l+2)%3][i-lo[0]][j-lo[1]][k-lo[2]]*
+                                                                                xp[(m+2)%3][(l+1)%3][i-lo[0]][j-lo[1]][k-lo[2]])/
                                                                                 f.jac[i*nxd[1]+j*nxd[2]+k]);
                     }
                 }
@@ -1015,8 +2055,8 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
-            for (int k=0; k<c.get_nx_loc(0); k++) {
-                for (int l=0; l<c.get_nx_loc(1); l++) {
+            for (int k=0; k<nloc[0]; k++) {
+                for (int l=0; l<nloc[1]; l++) {
                     delete[] xp[i][j][k][l];
                 }
             }
@@ -1025,7 +2065,7 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
     
     for (int i=0; i<3; i++) {
         for (int j=0; j<3; j++) {
-            for (int k=0; k<c.get_nx_loc(0); k++) {
+            for (int k=0; k<nloc[0]; k++) {
                 delete[] xp[i][j][k];
             }
         }
@@ -1045,117 +2085,344 @@ void block::set_grid(surface** surf, fields& f, const cartesian& cart, const fd_
 
 }
 
-void block::calc_df_mode2(const double dt, fields& f, const fd_type& fd) {
+bool block::check_rectilinear(surface** surf) {
+    // checks if block surfaces describe a rectangle (or rectangular prism) aligned with the
+    // coordinate axes with an evenly spaced grid, and if so sets the constant metric
+    // surfaces are global, so all processes containing the block make the same choice
+    
+    double x0[3], l0[3], xtest, tol;
+    int dir[3][2] = {{1,2},{0,2},{0,1}};
+    
+    for (int i=0; i<3; i++) {
+        x0[i] = 0.;
+        l0[i] = 1.;
+    }
+    
+    // find corner and side lengths using corner points of surfaces
+    
+    for (int i=0; i<ndim; i++) {
+        x0[i] = surf[0]->get_x(i,0,0);
+    }
+    
+    l0[0] = surf[1]->get_x(0,0,0)-x0[0];
+    l0[1] = surf[0]->get_x(1,c.get_nx(1)-1,0)-x0[1];
+    if (ndim == 3) {
+        l0[2] = surf[0]->get_x(2,0,c.get_nx(2)-1)-x0[2];
+    }
+    
+    tol = 0.;
+    
+    for (int i=0; i<ndim; i++) {
+        if (l0[i] <= 0.) {
+            return false;
+        }
+        tol = (l0[i] > tol) ? l0[i] : tol;
+    }
+    
+    tol *= 1.e-12;
+    
+    // check that all surface points lie on the evenly spaced grid
+    
+    for (int n=0; n<nbound; n++) {
+        for (int i=0; i<surf[n]->get_n(0); i++) {
+            for (int j=0; j<surf[n]->get_n(1); j++) {
+                for (int k=0; k<ndim; k++) {
+                    if (k == n/2) {
+                        xtest = x0[k]+(double)(n%2)*l0[k];
+                    } else if (k == dir[n/2][0]) {
+                        xtest = x0[k]+l0[k]*(double)i/(double)(surf[n]->get_n(0)-1);
+                    } else if (surf[n]->get_n(1) > 1) {
+                        xtest = x0[k]+l0[k]*(double)j/(double)(surf[n]->get_n(1)-1);
+                    } else {
+                        xtest = x0[k];
+                    }
+                    if (fabs(surf[n]->get_x(k,i,j)-xtest) > tol) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    
+    for (int i=0; i<ndim; i++) {
+        rmetric[i] = 1./l0[i];
+    }
+    
+    return true;
+    
+}
+
+template <int kind, int d, bool right, bool diss>
+inline void block::calc_df_rect(fields& f, const int index1, const int start, const int step, const int npts,
+                                const double* fc, const double* dcf, const double invrho, const double g2lam,
+                                const double g, const double lambda) const {
+    // adds terms for derivatives in direction d to df at a single point of a rectilinear block
+    // stencil fc is applied to points start+n*step, derivative terms are subtracted on the right boundary
+    // stencil is summed for each derivative and then scaled by material properties with the same grouping
+    // as calc_df_central_dir, so scalar and vectorized kernels give identical results
+    
+    double* df = f.df;
+    const fieldreal* fv = f.f;
+    const int n0 = nxd[0];
+    const int nf = (kind == 3) ? 9 : ((kind == 2) ? 5 : 3);
+    
+    if (kind == 3) {
+        // derivatives of velocity components and the tractions on planes normal to direction d
+        const int t1 = (d == 0) ? 3 : ((d == 1) ? 4 : 5);
+        const int t2 = (d == 0) ? 4 : ((d == 1) ? 6 : 7);
+        const int t3 = (d == 0) ? 5 : ((d == 1) ? 7 : 8);
+        double dvx = 0., dvy = 0., dvz = 0., ds1 = 0., ds2 = 0., ds3 = 0.;
+        for (int n=0; n<npts; n++) {
+            const int index2 = start+n*step;
+            dvx += fc[n]*fv[0*n0+index2];
+            dvy += fc[n]*fv[1*n0+index2];
+            dvz += fc[n]*fv[2*n0+index2];
+            ds1 += fc[n]*fv[t1*n0+index2];
+            ds2 += fc[n]*fv[t2*n0+index2];
+            ds3 += fc[n]*fv[t3*n0+index2];
+        }
+        if (right) {
+            dvx = -dvx;
+            dvy = -dvy;
+            dvz = -dvz;
+            ds1 = -ds1;
+            ds2 = -ds2;
+            ds3 = -ds3;
+        }
+        df[0*n0+index1] += invrho*ds1;
+        df[1*n0+index1] += invrho*ds2;
+        df[2*n0+index1] += invrho*ds3;
+        if (d == 0) {
+            df[3*n0+index1] += g2lam*dvx;
+            df[4*n0+index1] += g*dvy;
+            df[5*n0+index1] += g*dvz;
+            df[6*n0+index1] += lambda*dvx;
+            df[8*n0+index1] += lambda*dvx;
+        } else if (d == 1) {
+            df[3*n0+index1] += lambda*dvy;
+            df[4*n0+index1] += g*dvx;
+            df[6*n0+index1] += g2lam*dvy;
+            df[7*n0+index1] += g*dvz;
+            df[8*n0+index1] += lambda*dvy;
+        } else {
+            df[3*n0+index1] += lambda*dvz;
+            df[5*n0+index1] += g*dvx;
+            df[6*n0+index1] += lambda*dvz;
+            df[7*n0+index1] += g*dvy;
+            df[8*n0+index1] += g2lam*dvz;
+        }
+    } else if (kind == 2) {
+        const int t1 = (d == 0) ? 2 : 3;
+        const int t2 = (d == 0) ? 3 : 4;
+        double dvx = 0., dvy = 0., ds1 = 0., ds2 = 0.;
+        for (int n=0; n<npts; n++) {
+            const int index2 = start+n*step;
+            dvx += fc[n]*fv[0*n0+index2];
+            dvy += fc[n]*fv[1*n0+index2];
+            ds1 += fc[n]*fv[t1*n0+index2];
+            ds2 += fc[n]*fv[t2*n0+index2];
+        }
+        if (right) {
+            dvx = -dvx;
+            dvy = -dvy;
+            ds1 = -ds1;
+            ds2 = -ds2;
+        }
+        df[0*n0+index1] += invrho*ds1;
+        df[1*n0+index1] += invrho*ds2;
+        if (d == 0) {
+            df[2*n0+index1] += g2lam*dvx;
+            df[3*n0+index1] += g*dvy;
+            df[4*n0+index1] += lambda*dvx;
+        } else {
+            df[2*n0+index1] += lambda*dvy;
+            df[3*n0+index1] += g*dvx;
+            df[4*n0+index1] += g2lam*dvy;
+        }
+    } else {
+        double dvz = 0., ds = 0.;
+        for (int n=0; n<npts; n++) {
+            const int index2 = start+n*step;
+            dvz += fc[n]*fv[0*n0+index2];
+            ds += fc[n]*fv[(1+d)*n0+index2];
+        }
+        if (right) {
+            dvz = -dvz;
+            ds = -ds;
+        }
+        df[0*n0+index1] += invrho*ds;
+        df[(1+d)*n0+index1] += g*dvz;
+    }
+    if (diss) {
+        for (int c=0; c<nf; c++) {
+            for (int n=0; n<npts; n++) {
+                df[c*n0+index1] += cdiss*dcf[n]*fv[c*n0+start+n*step];
+            }
+        }
+    }
+    
+}
+
+template <int order, bool het, bool diss, bool rect>
+void block::calc_df_mode2(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]) {
     // calculates df of a low storage time step for a mode 2 problem
+
+    // copy interior stencil into fixed size arrays so loops over it can be unrolled
     
-    // x derivatives
+    double fdc[2*order-1], dc[2*order-1];
+    
+    for (int n=0; n<2*order-1; n++) {
+        fdc[n] = fd.fdcoeff[0][n];
+        dc[n] = fd.disscoeff[0][n];
+    }
+    
+    // time step divided by grid spacing (times the metric for rectilinear blocks), used with heterogeneous material properties
+    
+    double hdx[3];
+    
+    for (int d=0; d<ndim; d++) {
+        hdx[d] = rect ? dt*rmetric[d]/dx[d] : dt/dx[d];
+    }
+    
+    // x derivatives, df is first scaled by RK coefficient A
     
     int index1, index2, index3;
     double invjac, invrho = dt/mat.get_rho()/dx[0], g2lam = dt*(2.*mat.get_g()+mat.get_lambda())/dx[0];
     double g = dt*mat.get_g()/dx[0], lambda = dt*mat.get_lambda()/dx[0];
         
-    for (int i=mlb[0]; i<mc[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    if (rect) {
+        invrho = hdx[0]/mat.get_rho();
+        g2lam = hdx[0]*(2.*mat.get_g()+mat.get_lambda());
+        g = hdx[0]*mat.get_g();
+        lambda = hdx[0]*mat.get_lambda();
+    }
+    
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<min(mc[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
-            index3 = i-mlb[0]+1;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[0];
-                g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[0];
-                g = dt*f.mat[2*nxd[0]+index1]/dx[0];
-                lambda = dt*f.mat[nxd[0]+index1]/dx[0];
+            for (int c=0; c<5; c++) {
+                f.df[c*nxd[0]+index1] *= A;
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = (mlb[0]+n)*nxd[1]+j;
-                f.df[index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                          (f.metric[index2]*f.f[2*nxd[0]+index2]+
-                                           f.metric[nxd[0]+index2]*f.f[3*nxd[0]+index2]));
-                f.df[nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                          (f.metric[index2]*f.f[3*nxd[0]+index2]+
-                                           f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]));
-                f.df[2*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
-                                                                lambda*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]);
-                f.df[3*nxd[0]+index1] += g*fd.fdcoeff[index3][n]*(f.metric[index1]*f.f[nxd[0]+index2]+
-                                                                  f.metric[nxd[0]+index1]*f.f[index2]);
-                f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                lambda*f.metric[index1]*f.f[index2]);
-                if (cdiss > 0.) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                    f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                    f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+            index3 = i-mlb[0]+1;
+            if (het) {
+                invrho = hdx[0]*f.matd[index1];
+                g2lam = hdx[0]*f.matd[nxd[0]+index1];
+                g = hdx[0]*f.mat[2*nxd[0]+index1];
+                lambda = hdx[0]*f.mat[nxd[0]+index1];
+            }
+            if (rect) {
+                calc_df_rect<2,0,false,diss>(f,index1,mlb[0]*nxd[1]+j,nxd[1],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = (mlb[0]+n)*nxd[1]+j;
+                    f.df[index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                              (f.metric[index2]*f.f[2*nxd[0]+index2]+
+                                               f.metric[nxd[0]+index2]*f.f[3*nxd[0]+index2]));
+                    f.df[nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                              (f.metric[index2]*f.f[3*nxd[0]+index2]+
+                                               f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]));
+                    f.df[2*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
+                                                                    lambda*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]);
+                    f.df[3*nxd[0]+index1] += g*fd.fdcoeff[index3][n]*(f.metric[index1]*f.f[nxd[0]+index2]+
+                                                                      f.metric[nxd[0]+index1]*f.f[index2]);
+                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                    lambda*f.metric[index1]*f.f[index2]);
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mc[0]; i<mrb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=max(mc[0],pmin[0]); i<min(mrb[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[0];
-                g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[0];
-                g = dt*f.mat[2*nxd[0]+index1]/dx[0];
-                lambda = dt*f.mat[nxd[0]+index1]/dx[0];
-            }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<2*fd.sbporder-1; n++) {
-                index2 = index1+(-fd.sbporder+1+n)*nxd[1];
-                f.df[index1] += (invjac*fd.fdcoeff[0][n]*f.jac[index2]*
-                                          (f.metric[index2]*f.f[2*nxd[0]+index2]+
-                                           f.metric[nxd[0]+index2]*f.f[3*nxd[0]+index2]));
-                f.df[nxd[0]+index1] += (invjac*fd.fdcoeff[0][n]*f.jac[index2]*
-                                          (f.metric[index2]*f.f[3*nxd[0]+index2]+
-                                           f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]));
-                f.df[2*nxd[0]+index1] += fd.fdcoeff[0][n]*(g2lam*f.metric[index1]*f.f[index2]+
-                                                           lambda*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]);
-                f.df[3*nxd[0]+index1] += g*fd.fdcoeff[0][n]*(f.metric[index1]*f.f[nxd[0]+index2]+
-                                                             f.metric[nxd[0]+index1]*f.f[index2]);
-                f.df[4*nxd[0]+index1] += fd.fdcoeff[0][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                           lambda*f.metric[index1]*f.f[index2]);
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                    f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                    f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+            for (int c=0; c<5; c++) {
+                f.df[c*nxd[0]+index1] *= A;
+            }
+            if (het) {
+                invrho = hdx[0]*f.matd[index1];
+                g2lam = hdx[0]*f.matd[nxd[0]+index1];
+                g = hdx[0]*f.mat[2*nxd[0]+index1];
+                lambda = hdx[0]*f.mat[nxd[0]+index1];
+            }
+            if (rect) {
+                calc_df_rect<2,0,false,diss>(f,index1,index1+(-order+1)*nxd[1],nxd[1],2*order-1,fdc,dc,invrho,g2lam,g,lambda);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<2*order-1; n++) {
+                    index2 = index1+(-order+1+n)*nxd[1];
+                    f.df[index1] += (invjac*fdc[n]*f.jac[index2]*
+                                              (f.metric[index2]*f.f[2*nxd[0]+index2]+
+                                               f.metric[nxd[0]+index2]*f.f[3*nxd[0]+index2]));
+                    f.df[nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*
+                                              (f.metric[index2]*f.f[3*nxd[0]+index2]+
+                                               f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]));
+                    f.df[2*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[index1]*f.f[index2]+
+                                                               lambda*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]);
+                    f.df[3*nxd[0]+index1] += g*fdc[n]*(f.metric[index1]*f.f[nxd[0]+index2]+
+                                                                 f.metric[nxd[0]+index1]*f.f[index2]);
+                    f.df[4*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                               lambda*f.metric[index1]*f.f[index2]);
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                        f.df[3*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                        f.df[4*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mrb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=max(mrb[0],pmin[0]); i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
-            index3 = prb[0]-i;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[0];
-                g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[0];
-                g = dt*f.mat[2*nxd[0]+index1]/dx[0];
-                lambda = dt*f.mat[nxd[0]+index1]/dx[0];
+            for (int c=0; c<5; c++) {
+                f.df[c*nxd[0]+index1] *= A;
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = (prb[0]-1-n)*nxd[1]+j;
-                f.df[index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                 (f.metric[index2]*f.f[2*nxd[0]+index2]+
-                                  f.metric[nxd[0]+index2]*f.f[3*nxd[0]+index2]));
-                f.df[nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                        (f.metric[index2]*f.f[3*nxd[0]+index2]+
-                                         f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]));
-                f.df[2*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
-                                                                lambda*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]);
-                f.df[3*nxd[0]+index1] -= g*fd.fdcoeff[index3][n]*(f.metric[index1]*f.f[nxd[0]+index2]+
-                                                                  f.metric[nxd[0]+index1]*f.f[index2]);
-                f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                lambda*f.metric[index1]*f.f[index2]);
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                    f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                    f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+            index3 = prb[0]-i;
+            if (het) {
+                invrho = hdx[0]*f.matd[index1];
+                g2lam = hdx[0]*f.matd[nxd[0]+index1];
+                g = hdx[0]*f.mat[2*nxd[0]+index1];
+                lambda = hdx[0]*f.mat[nxd[0]+index1];
+            }
+            if (rect) {
+                calc_df_rect<2,0,true,diss>(f,index1,(prb[0]-1)*nxd[1]+j,-nxd[1],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = (prb[0]-1-n)*nxd[1]+j;
+                    f.df[index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                     (f.metric[index2]*f.f[2*nxd[0]+index2]+
+                                      f.metric[nxd[0]+index2]*f.f[3*nxd[0]+index2]));
+                    f.df[nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                            (f.metric[index2]*f.f[3*nxd[0]+index2]+
+                                             f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]));
+                    f.df[2*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
+                                                                    lambda*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]);
+                    f.df[3*nxd[0]+index1] -= g*fd.fdcoeff[index3][n]*(f.metric[index1]*f.f[nxd[0]+index2]+
+                                                                      f.metric[nxd[0]+index1]*f.f[index2]);
+                    f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                    lambda*f.metric[index1]*f.f[index2]);
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
@@ -1168,108 +2435,130 @@ void block::calc_df_mode2(const double dt, fields& f, const fd_type& fd) {
     g *= dx[0]/dx[1];
     lambda *= dx[0]/dx[1];
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<mc[1]; j++) {
+    if (rect) {
+        invrho = hdx[1]/mat.get_rho();
+        g2lam = hdx[1]*(2.*mat.get_g()+mat.get_lambda());
+        g = hdx[1]*mat.get_g();
+        lambda = hdx[1]*mat.get_lambda();
+    }
+    
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<min(mc[1],pmax[1]); j++) {
             index1 = i*nxd[1]+j;
             index3 = j-mlb[1]+1;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[1];
-                g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[1];
-                g = dt*f.mat[2*nxd[0]+index1]/dx[1];
-                lambda = dt*f.mat[nxd[0]+index1]/dx[1];
-            }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = i*nxd[1]+mlb[1]+n;
-                f.df[index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                          (f.metric[ndim*nxd[0]+index2]*f.f[2*nxd[0]+index2]+
-                                           f.metric[(ndim+1)*nxd[0]+index2]*f.f[3*nxd[0]+index2]));
-                f.df[nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                          (f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                           f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]));
-                f.df[2*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                lambda*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                f.df[3*nxd[0]+index1] += g*fd.fdcoeff[index3][n]*(f.metric[ndim*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                             f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
-                f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                lambda*f.metric[ndim*nxd[0]+index1]*f.f[index2]);
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                    f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                    f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+            if (het) {
+                invrho = hdx[1]*f.matd[index1];
+                g2lam = hdx[1]*f.matd[nxd[0]+index1];
+                g = hdx[1]*f.mat[2*nxd[0]+index1];
+                lambda = hdx[1]*f.mat[nxd[0]+index1];
+            }
+            if (rect) {
+                calc_df_rect<2,1,false,diss>(f,index1,i*nxd[1]+mlb[1],1,3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = i*nxd[1]+mlb[1]+n;
+                    f.df[index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                              (f.metric[ndim*nxd[0]+index2]*f.f[2*nxd[0]+index2]+
+                                               f.metric[(ndim+1)*nxd[0]+index2]*f.f[3*nxd[0]+index2]));
+                    f.df[nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                              (f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                               f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]));
+                    f.df[2*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                    lambda*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                    f.df[3*nxd[0]+index1] += g*fd.fdcoeff[index3][n]*(f.metric[ndim*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                 f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
+                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                    lambda*f.metric[ndim*nxd[0]+index1]*f.f[index2]);
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mc[1]; j<mrb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mc[1],pmin[1]); j<min(mrb[1],pmax[1]); j++) {
             index1 = i*nxd[1]+j;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[1];
-                g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[1];
-                g = dt*f.mat[2*nxd[0]+index1]/dx[1];
-                lambda = dt*f.mat[nxd[0]+index1]/dx[1];
-            }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<2*fd.sbporder-1; n++) {
-                index2 = index1-fd.sbporder+1+n;
-                f.df[index1] += (invjac*fd.fdcoeff[0][n]*f.jac[index2]*
-                                          (f.metric[ndim*nxd[0]+index2]*f.f[2*nxd[0]+index2]+
-                                           f.metric[(ndim+1)*nxd[0]+index2]*f.f[3*nxd[0]+index2]));
-                f.df[nxd[0]+index1] += (invjac*fd.fdcoeff[0][n]*f.jac[index2]*
-                                          (f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                           f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]));
-                f.df[2*nxd[0]+index1] += fd.fdcoeff[0][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                           lambda*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                f.df[3*nxd[0]+index1] += g*fd.fdcoeff[0][n]*(f.metric[ndim*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                             f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
-                f.df[4*nxd[0]+index1] += fd.fdcoeff[0][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                           lambda*f.metric[ndim*nxd[0]+index1]*f.f[index2]);
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                    f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                    f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+            if (het) {
+                invrho = hdx[1]*f.matd[index1];
+                g2lam = hdx[1]*f.matd[nxd[0]+index1];
+                g = hdx[1]*f.mat[2*nxd[0]+index1];
+                lambda = hdx[1]*f.mat[nxd[0]+index1];
+            }
+            if (rect) {
+                calc_df_rect<2,1,false,diss>(f,index1,index1-order+1,1,2*order-1,fdc,dc,invrho,g2lam,g,lambda);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<2*order-1; n++) {
+                    index2 = index1-order+1+n;
+                    f.df[index1] += (invjac*fdc[n]*f.jac[index2]*
+                                              (f.metric[ndim*nxd[0]+index2]*f.f[2*nxd[0]+index2]+
+                                               f.metric[(ndim+1)*nxd[0]+index2]*f.f[3*nxd[0]+index2]));
+                    f.df[nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*
+                                              (f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                               f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]));
+                    f.df[2*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                               lambda*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                    f.df[3*nxd[0]+index1] += g*fdc[n]*(f.metric[ndim*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                 f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
+                    f.df[4*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                               lambda*f.metric[ndim*nxd[0]+index1]*f.f[index2]);
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                        f.df[3*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                        f.df[4*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mrb[1]; j<prb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mrb[1],pmin[1]); j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
             index3 = prb[1]-j;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[1];
-                g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[1];
-                g = dt*f.mat[2*nxd[0]+index1]/dx[1];
-                lambda = dt*f.mat[nxd[0]+index1]/dx[1];
-            }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = i*nxd[1]+(prb[1]-1-n);
-                f.df[index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                          (f.metric[ndim*nxd[0]+index2]*f.f[2*nxd[0]+index2]+
-                                           f.metric[(ndim+1)*nxd[0]+index2]*f.f[3*nxd[0]+index2]));
-                f.df[nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
-                                          (f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                           f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]));
-                f.df[2*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                lambda*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                f.df[3*nxd[0]+index1] -= g*fd.fdcoeff[index3][n]*(f.metric[ndim*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                  f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
-                f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                lambda*f.metric[ndim*nxd[0]+index1]*f.f[index2]);
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                    f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                    f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+            if (het) {
+                invrho = hdx[1]*f.matd[index1];
+                g2lam = hdx[1]*f.matd[nxd[0]+index1];
+                g = hdx[1]*f.mat[2*nxd[0]+index1];
+                lambda = hdx[1]*f.mat[nxd[0]+index1];
+            }
+            if (rect) {
+                calc_df_rect<2,1,true,diss>(f,index1,i*nxd[1]+prb[1]-1,-1,3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = i*nxd[1]+(prb[1]-1-n);
+                    f.df[index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                              (f.metric[ndim*nxd[0]+index2]*f.f[2*nxd[0]+index2]+
+                                               f.metric[(ndim+1)*nxd[0]+index2]*f.f[3*nxd[0]+index2]));
+                    f.df[nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*
+                                              (f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                               f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]));
+                    f.df[2*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                    lambda*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                    f.df[3*nxd[0]+index1] -= g*fd.fdcoeff[index3][n]*(f.metric[ndim*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                      f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
+                    f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                    lambda*f.metric[ndim*nxd[0]+index1]*f.f[index2]);
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
@@ -1277,14 +2566,15 @@ void block::calc_df_mode2(const double dt, fields& f, const fd_type& fd) {
     
 }
 
-void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
+void block::calc_df_szz(const double dt, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]) {
     // calculates change in szz for a mode 2 plastic problem
     
     double nu = 0.5*mat.get_lambda()/(mat.get_lambda()+mat.get_g());
     int index;
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index) firstprivate(nu)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index = i*nxd[1]+j;
             if (f.hetmat) {
                 nu = 0.5*f.mat[nxd[0]+index]/(f.mat[nxd[0]+index]+f.mat[nxd[1]+index]);
@@ -1298,8 +2588,8 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
 /*    int index1, index2, index3;
     double lambda = dt*mat.get_lambda()/dx[0];
     
-    for (int i=mlb[0]; i<mc[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    for (int i=pmin[0]; i<min(mc[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
             index3 = i-mlb[0]+1;
             for (int n=0; n<3*(fd.sbporder-1); n++) {
@@ -1310,8 +2600,8 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
         }
     }
     
-    for (int i=mc[0]; i<mrb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    for (int i=max(mc[0],pmin[0]); i<min(mrb[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
             for (int n=0; n<2*fd.sbporder-1; n++) {
                 index2 = index1+(-fd.sbporder+1+n)*nxd[1];
@@ -1321,8 +2611,8 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
         }
     }
     
-    for (int i=mrb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    for (int i=max(mrb[0],pmin[0]); i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
             index3 = prb[0]-i;
             for (int n=0; n<3*(fd.sbporder-1); n++) {
@@ -1337,8 +2627,8 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
     
     lambda *= dx[0]/dx[1];
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<mc[1]; j++) {
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<min(mc[1],pmax[1]); j++) {
             index1 = i*nxd[1]+j;
             index3 = j-mlb[1]+1;
             for (int n=0; n<3*(fd.sbporder-1); n++) {
@@ -1349,8 +2639,8 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mc[1]; j<mrb[1]; j++) {
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mc[1],pmin[1]); j<min(mrb[1],pmax[1]); j++) {
             index1 = i*nxd[1]+j;
             for (int n=0; n<2*fd.sbporder-1; n++) {
                 index2 = index1-fd.sbporder+1+n;
@@ -1360,8 +2650,8 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mrb[1]; j<prb[1]; j++) {
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mrb[1],pmin[1]); j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
             index3 = prb[1]-j;
             for (int n=0; n<3*(fd.sbporder-1); n++) {
@@ -1372,8 +2662,8 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
         }
     }
  
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index = i*nxd[1]+j;
             cout << f.df[5*nxd[0]+index] << " " << nu*(f.df[2*nxd[0]+index]+f.df[4*nxd[0]+index]) << "\n";
         }
@@ -1381,80 +2671,127 @@ void block::calc_df_szz(const double dt, fields& f, const fd_type& fd) {
 
 }
 
-void block::calc_df_mode3(const double dt, fields& f, const fd_type& fd) {
+template <int order, bool het, bool diss, bool rect>
+void block::calc_df_mode3(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]) {
     // calculates df of a low storage time step for a mode 3 problem
+
+    // copy interior stencil into fixed size arrays so loops over it can be unrolled
     
-    // x derivatives
+    double fdc[2*order-1], dc[2*order-1];
+    
+    for (int n=0; n<2*order-1; n++) {
+        fdc[n] = fd.fdcoeff[0][n];
+        dc[n] = fd.disscoeff[0][n];
+    }
+    
+    // time step divided by grid spacing (times the metric for rectilinear blocks), used with heterogeneous material properties
+    
+    double hdx[3];
+    
+    for (int d=0; d<ndim; d++) {
+        hdx[d] = rect ? dt*rmetric[d]/dx[d] : dt/dx[d];
+    }
+    
+    // x derivatives, df is first scaled by RK coefficient A
     
     int index1, index2, index3;
     double invjac, invrho = dt/mat.get_rho()/dx[0], g = dt*mat.get_g()/dx[0];
     
-    for (int i=mlb[0]; i<mc[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    if (rect) {
+        invrho = hdx[0]/mat.get_rho();
+        g = hdx[0]*mat.get_g();
+    }
+    
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g)
+    for (int i=pmin[0]; i<min(mc[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
+            for (int c=0; c<3; c++) {
+                f.df[c*nxd[0]+index1] *= A;
+            }
             index3 = i-mlb[0]+1;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[0];
-                g = dt*f.mat[nxd[0]+index1]/dx[0];
+            if (het) {
+                invrho = hdx[0]*f.matd[index1];
+                g = hdx[0]*f.mat[nxd[0]+index1];
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = (mlb[0]+n)*nxd[1]+j;
-                f.df[index1] += invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[nxd[0]+index2]+
-                                                                             f.metric[nxd[0]+index2]*f.f[2*nxd[0]+index2]);
-                f.df[nxd[0]+index1] += g*f.metric[index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                f.df[2*nxd[0]+index1] += g*f.metric[nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+            if (rect) {
+                calc_df_rect<1,0,false,diss>(f,index1,mlb[0]*nxd[1]+j,nxd[1],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,0.,g,0.);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = (mlb[0]+n)*nxd[1]+j;
+                    f.df[index1] += invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[nxd[0]+index2]+
+                                                                                 f.metric[nxd[0]+index2]*f.f[2*nxd[0]+index2]);
+                    f.df[nxd[0]+index1] += g*f.metric[index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    f.df[2*nxd[0]+index1] += g*f.metric[nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mc[0]; i<mrb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g)
+    for (int i=max(mc[0],pmin[0]); i<min(mrb[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[0];
-                g = dt*f.mat[nxd[0]+index1]/dx[0];
+            for (int c=0; c<3; c++) {
+                f.df[c*nxd[0]+index1] *= A;
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<2*fd.sbporder-1; n++) {
-                index2 = index1+(-fd.sbporder+1+n)*nxd[1];
-                f.df[index1] += invjac*fd.fdcoeff[0][n]*f.jac[index2]*(f.metric[index2]*f.f[nxd[0]+index2]+
-                                                                             f.metric[nxd[0]+index2]*f.f[2*nxd[0]+index2]);
-                f.df[nxd[0]+index1] += g*f.metric[index1]*fd.fdcoeff[0][n]*f.f[index2];
-                f.df[2*nxd[0]+index1] += g*f.metric[nxd[0]+index1]*fd.fdcoeff[0][n]*f.f[index2];
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+            if (het) {
+                invrho = hdx[0]*f.matd[index1];
+                g = hdx[0]*f.mat[nxd[0]+index1];
+            }
+            if (rect) {
+                calc_df_rect<1,0,false,diss>(f,index1,index1+(-order+1)*nxd[1],nxd[1],2*order-1,fdc,dc,invrho,0.,g,0.);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<2*order-1; n++) {
+                    index2 = index1+(-order+1+n)*nxd[1];
+                    f.df[index1] += invjac*fdc[n]*f.jac[index2]*(f.metric[index2]*f.f[nxd[0]+index2]+
+                                                                                 f.metric[nxd[0]+index2]*f.f[2*nxd[0]+index2]);
+                    f.df[nxd[0]+index1] += g*f.metric[index1]*fdc[n]*f.f[index2];
+                    f.df[2*nxd[0]+index1] += g*f.metric[nxd[0]+index1]*fdc[n]*f.f[index2];
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mrb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g)
+    for (int i=max(mrb[0],pmin[0]); i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
+            for (int c=0; c<3; c++) {
+                f.df[c*nxd[0]+index1] *= A;
+            }
             index3 = prb[0]-i;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[0];
-                g = dt*f.mat[nxd[0]+index1]/dx[0];
+            if (het) {
+                invrho = hdx[0]*f.matd[index1];
+                g = hdx[0]*f.mat[nxd[0]+index1];
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = (prb[0]-1-n)*nxd[1]+j;
-                f.df[index1] -= invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[nxd[0]+index2]+
-                                                                             f.metric[nxd[0]+index2]*f.f[2*nxd[0]+index2]);
-                f.df[nxd[0]+index1] -= g*f.metric[index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                f.df[2*nxd[0]+index1] -= g*f.metric[nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+            if (rect) {
+                calc_df_rect<1,0,true,diss>(f,index1,(prb[0]-1)*nxd[1]+j,-nxd[1],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,0.,g,0.);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = (prb[0]-1-n)*nxd[1]+j;
+                    f.df[index1] -= invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[nxd[0]+index2]+
+                                                                                 f.metric[nxd[0]+index2]*f.f[2*nxd[0]+index2]);
+                    f.df[nxd[0]+index1] -= g*f.metric[index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    f.df[2*nxd[0]+index1] -= g*f.metric[nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
@@ -1465,72 +2802,92 @@ void block::calc_df_mode3(const double dt, fields& f, const fd_type& fd) {
     invrho *= dx[0]/dx[1];
     g *= dx[0]/dx[1];
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<mc[1]; j++) {
+    if (rect) {
+        invrho = hdx[1]/mat.get_rho();
+        g = hdx[1]*mat.get_g();
+    }
+    
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<min(mc[1],pmax[1]); j++) {
             index1 = i*nxd[1]+j;
             index3 = j-mlb[1]+1;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[1];
-                g = dt*f.mat[nxd[0]+index1]/dx[1];
+            if (het) {
+                invrho = hdx[1]*f.matd[index1];
+                g = hdx[1]*f.mat[nxd[0]+index1];
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = i*nxd[1]+mlb[1]+n;
-                f.df[index1] += invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[nxd[0]+index2]+
-                                                                            f.metric[(ndim+1)*nxd[0]+index2]*f.f[2*nxd[0]+index2]);
-                f.df[nxd[0]+i*nxd[1]+j] += g*f.metric[ndim*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                f.df[2*nxd[0]+i*nxd[1]+j] += g*f.metric[(ndim+1)*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+            if (rect) {
+                calc_df_rect<1,1,false,diss>(f,index1,i*nxd[1]+mlb[1],1,3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,0.,g,0.);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = i*nxd[1]+mlb[1]+n;
+                    f.df[index1] += invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[nxd[0]+index2]+
+                                                                                f.metric[(ndim+1)*nxd[0]+index2]*f.f[2*nxd[0]+index2]);
+                    f.df[nxd[0]+i*nxd[1]+j] += g*f.metric[ndim*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    f.df[2*nxd[0]+i*nxd[1]+j] += g*f.metric[(ndim+1)*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mc[1]; j<mrb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mc[1],pmin[1]); j<min(mrb[1],pmax[1]); j++) {
             index1 = i*nxd[1]+j;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[1];
-                g = dt*f.mat[nxd[0]+index1]/dx[1];
+            if (het) {
+                invrho = hdx[1]*f.matd[index1];
+                g = hdx[1]*f.mat[nxd[0]+index1];
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<2*fd.sbporder-1; n++) {
-                index2 = index1-fd.sbporder+1+n;
-                f.df[index1] += invjac*fd.fdcoeff[0][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[nxd[0]+index2]+
-                                                                            f.metric[(ndim+1)*nxd[0]+index2]*f.f[2*nxd[0]+index2]);
-                f.df[nxd[0]+i*nxd[1]+j] += g*f.metric[ndim*nxd[0]+index1]*fd.fdcoeff[0][n]*f.f[index2];
-                f.df[2*nxd[0]+i*nxd[1]+j] += g*f.metric[(ndim+1)*nxd[0]+index1]*fd.fdcoeff[0][n]*f.f[index2];
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+            if (rect) {
+                calc_df_rect<1,1,false,diss>(f,index1,index1-order+1,1,2*order-1,fdc,dc,invrho,0.,g,0.);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<2*order-1; n++) {
+                    index2 = index1-order+1+n;
+                    f.df[index1] += invjac*fdc[n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[nxd[0]+index2]+
+                                                                                f.metric[(ndim+1)*nxd[0]+index2]*f.f[2*nxd[0]+index2]);
+                    f.df[nxd[0]+i*nxd[1]+j] += g*f.metric[ndim*nxd[0]+index1]*fdc[n]*f.f[index2];
+                    f.df[2*nxd[0]+i*nxd[1]+j] += g*f.metric[(ndim+1)*nxd[0]+index1]*fdc[n]*f.f[index2];
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mrb[1]; j<prb[1]; j++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mrb[1],pmin[1]); j<pmax[1]; j++) {
             index1 = i*nxd[1]+j;
             index3 = prb[1]-j;
-            if (f.hetmat) {
-                invrho = dt/f.mat[index1]/dx[1];
-                g = dt*f.mat[nxd[0]+index1]/dx[1];
+            if (het) {
+                invrho = hdx[1]*f.matd[index1];
+                g = hdx[1]*f.mat[nxd[0]+index1];
             }
-            invjac = invrho/f.jac[index1];
-            for (int n=0; n<3*(fd.sbporder-1); n++) {
-                index2 = i*nxd[1]+(prb[1]-1-n);
-                f.df[index1] -= invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[nxd[0]+index2]+
-                                                                            f.metric[(ndim+1)*nxd[0]+index2]*f.f[2*nxd[0]+index2]);
-                f.df[nxd[0]+i*nxd[1]+j] -= g*f.metric[ndim*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                f.df[2*nxd[0]+i*nxd[1]+j] -= g*f.metric[(ndim+1)*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
-                if (dissipation) {
-                    f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                    f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                    f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+            if (rect) {
+                calc_df_rect<1,1,true,diss>(f,index1,i*nxd[1]+prb[1]-1,-1,3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,0.,g,0.);
+            } else {
+                invjac = invrho/f.jac[index1];
+                for (int n=0; n<3*(order-1); n++) {
+                    index2 = i*nxd[1]+(prb[1]-1-n);
+                    f.df[index1] -= invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[nxd[0]+index2]+
+                                                                                f.metric[(ndim+1)*nxd[0]+index2]*f.f[2*nxd[0]+index2]);
+                    f.df[nxd[0]+i*nxd[1]+j] -= g*f.metric[ndim*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    f.df[2*nxd[0]+i*nxd[1]+j] -= g*f.metric[(ndim+1)*nxd[0]+index1]*fd.fdcoeff[index3][n]*f.f[index2];
+                    if (diss) {
+                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                    }
                 }
             }
         }
@@ -1538,171 +2895,219 @@ void block::calc_df_mode3(const double dt, fields& f, const fd_type& fd) {
     
 }
 
-void block::calc_df_3d(const double dt, fields& f, const fd_type& fd) {
+template <int order, bool het, bool diss, bool rect>
+void block::calc_df_3d(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]) {
     // calculates df of a low storage time step for a 3d problem
+
+    // copy interior stencil into fixed size arrays so loops over it can be unrolled
     
-    // x derivatives
+    double fdc[2*order-1], dc[2*order-1];
+    
+    for (int n=0; n<2*order-1; n++) {
+        fdc[n] = fd.fdcoeff[0][n];
+        dc[n] = fd.disscoeff[0][n];
+    }
+    
+    // time step divided by grid spacing (times the metric for rectilinear blocks), used with heterogeneous material properties
+    
+    double hdx[3];
+    
+    for (int d=0; d<ndim; d++) {
+        hdx[d] = rect ? dt*rmetric[d]/dx[d] : dt/dx[d];
+    }
+    
+    // x derivatives, df is first scaled by RK coefficient A
     
     int index1, index2, index3;
     double invjac, invrho = dt/mat.get_rho()/dx[0], g2lam = dt*(2.*mat.get_g()+mat.get_lambda())/dx[0];
     double g = dt*mat.get_g()/dx[0], lambda = dt*mat.get_lambda()/dx[0];
     
-    for (int i=mlb[0]; i<mc[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
+    if (rect) {
+        invrho = hdx[0]/mat.get_rho();
+        g2lam = hdx[0]*(2.*mat.get_g()+mat.get_lambda());
+        g = hdx[0]*mat.get_g();
+        lambda = hdx[0]*mat.get_lambda();
+    }
+    
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<min(mc[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
+            for (int k=pmin[2]; k<pmax[2]; k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[0];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[0];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[0];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[0];
+                for (int c=0; c<9; c++) {
+                    f.df[c*nxd[0]+index1] *= A;
+                }
+                if (het) {
+                    invrho = hdx[0]*f.matd[index1];
+                    g2lam = hdx[0]*f.matd[nxd[0]+index1];
+                    g = hdx[0]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[0]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
                 index3 = i-mlb[0]+1;
-                for (int n=0; n<3*(fd.sbporder-1); n++) {
-                    index2 = (mlb[0]+n)*nxd[1]+j*nxd[2]+k;
-                    f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
-                                                                    lambda*(f.metric[nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[2*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[index1]*f.f[index2]+
-                                                                            f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[2*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[index1]*f.f[index2]+
-                                                                            f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,0,false,diss>(f,index1,mlb[0]*nxd[1]+j*nxd[2]+k,nxd[1],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<3*(order-1); n++) {
+                        index2 = (mlb[0]+n)*nxd[1]+j*nxd[2]+k;
+                        f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
+                                                                        lambda*(f.metric[nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[2*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[index1]*f.f[index2]+
+                                                                                f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[2*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[index1]*f.f[index2]+
+                                                                                f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
         }
     }
     
-    for (int i=mc[0]; i<mrb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=max(mc[0],pmin[0]); i<min(mrb[0],pmax[0]); i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
+            for (int k=pmin[2]; k<pmax[2]; k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[0];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[0];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[0];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[0];
+                for (int c=0; c<9; c++) {
+                    f.df[c*nxd[0]+index1] *= A;
                 }
-                invjac = invrho/f.jac[index1];
-                index3 = 0;
-                for (int n=0; n<2*fd.sbporder-1; n++) {
-                    index2 = index1+(-fd.sbporder+1+n)*nxd[1];
-                    f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
-                                                                    lambda*(f.metric[nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[2*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[index1]*f.f[index2]+
-                                                                            f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[2*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[index1]*f.f[index2]+
-                                                                            f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (het) {
+                    invrho = hdx[0]*f.matd[index1];
+                    g2lam = hdx[0]*f.matd[nxd[0]+index1];
+                    g = hdx[0]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[0]*f.mat[nxd[0]+index1];
+                }
+                if (rect) {
+                    calc_df_rect<3,0,false,diss>(f,index1,index1+(-order+1)*nxd[1],nxd[1],2*order-1,fdc,dc,invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<2*order-1; n++) {
+                        index2 = index1+(-order+1+n)*nxd[1];
+                        f.df[0*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[index1]*f.f[index2]+
+                                                                        lambda*(f.metric[nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] += fdc[n]*g*(f.metric[index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] += fdc[n]*g*(f.metric[index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[2*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[index1]*f.f[index2]+
+                                                                                f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] += fdc[n]*g*(f.metric[nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[2*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[index1]*f.f[index2]+
+                                                                                f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
         }
     }
     
-    for (int i=mrb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=max(mrb[0],pmin[0]); i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
+            for (int k=pmin[2]; k<pmax[2]; k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[0];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[0];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[0];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[0];
+                for (int c=0; c<9; c++) {
+                    f.df[c*nxd[0]+index1] *= A;
+                }
+                if (het) {
+                    invrho = hdx[0]*f.matd[index1];
+                    g2lam = hdx[0]*f.matd[nxd[0]+index1];
+                    g = hdx[0]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[0]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
                 index3 = prb[0]-i;
-                for (int n=0; n<3*(fd.sbporder-1); n++) {
-                    index2 = (prb[0]-1-n)*nxd[1]+j*nxd[2]+k;
-                    f.df[0*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[2*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
-                                                                    lambda*(f.metric[nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[2*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[index1]*f.f[index2]+
-                                                                            f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[2*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[index1]*f.f[index2]+
-                                                                            f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,0,true,diss>(f,index1,(prb[0]-1)*nxd[1]+j*nxd[2]+k,-nxd[1],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<3*(order-1); n++) {
+                        index2 = (prb[0]-1-n)*nxd[1]+j*nxd[2]+k;
+                        f.df[0*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[2*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[index1]*f.f[index2]+
+                                                                        lambda*(f.metric[nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[2*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[index1]*f.f[index2]+
+                                                                                f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[2*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[2*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[index1]*f.f[index2]+
+                                                                                f.metric[nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
@@ -1716,162 +3121,183 @@ void block::calc_df_3d(const double dt, fields& f, const fd_type& fd) {
     g *= dx[0]/dx[1];
     lambda *= dx[0]/dx[1];
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<mc[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
+    if (rect) {
+        invrho = hdx[1]/mat.get_rho();
+        g2lam = hdx[1]*(2.*mat.get_g()+mat.get_lambda());
+        g = hdx[1]*mat.get_g();
+        lambda = hdx[1]*mat.get_lambda();
+    }
+    
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<min(mc[1],pmax[1]); j++) {
+            for (int k=pmin[2]; k<pmax[2]; k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[1];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[1];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[1];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[1];
+                if (het) {
+                    invrho = hdx[1]*f.matd[index1];
+                    g2lam = hdx[1]*f.matd[nxd[0]+index1];
+                    g = hdx[1]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[1]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
                 index3 = j-mlb[1]+1;
-                for (int n=0; n<3*(fd.sbporder-1); n++) {
-                    index2 = i*nxd[1]+(mlb[1]+n)*nxd[2]+k;
-                    f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                    lambda*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(ndim+2)*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,1,false,diss>(f,index1,i*nxd[1]+mlb[1]*nxd[2]+k,nxd[2],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<3*(order-1); n++) {
+                        index2 = i*nxd[1]+(mlb[1]+n)*nxd[2]+k;
+                        f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                        lambda*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(ndim+2)*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mc[1]; j<mrb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mc[1],pmin[1]); j<min(mrb[1],pmax[1]); j++) {
+            for (int k=pmin[2]; k<pmax[2]; k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[1];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[1];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[1];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[1];
+                if (het) {
+                    invrho = hdx[1]*f.matd[index1];
+                    g2lam = hdx[1]*f.matd[nxd[0]+index1];
+                    g = hdx[1]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[1]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
-                index3 = 0;
-                for (int n=0; n<2*fd.sbporder-1; n++) {
-                    index2 = index1+(-fd.sbporder+1+n)*nxd[2];
-                    f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                    lambda*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(ndim+2)*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,1,false,diss>(f,index1,index1+(-order+1)*nxd[2],nxd[2],2*order-1,fdc,dc,invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<2*order-1; n++) {
+                        index2 = index1+(-order+1+n)*nxd[2];
+                        f.df[0*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                        lambda*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] += fdc[n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] += fdc[n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(ndim+2)*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] += fdc[n]*g*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mrb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=max(mrb[1],pmin[1]); j<pmax[1]; j++) {
+            for (int k=pmin[2]; k<pmax[2]; k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[1];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[1];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[1];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[1];
+                if (het) {
+                    invrho = hdx[1]*f.matd[index1];
+                    g2lam = hdx[1]*f.matd[nxd[0]+index1];
+                    g = hdx[1]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[1]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
                 index3 = prb[1]-j;
-                for (int n=0; n<3*(fd.sbporder-1); n++) {
-                    index2 = i*nxd[1]+(prb[1]-1-n)*nxd[2]+k;
-                    f.df[0*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[(ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                    lambda*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(ndim+2)*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,1,true,diss>(f,index1,i*nxd[1]+(prb[1]-1)*nxd[2]+k,-nxd[2],3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<3*(order-1); n++) {
+                        index2 = i*nxd[1]+(prb[1]-1-n)*nxd[2]+k;
+                        f.df[0*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[(ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                        lambda*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[(ndim+1)*nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(ndim+2)*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[(ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
@@ -1885,162 +3311,183 @@ void block::calc_df_3d(const double dt, fields& f, const fd_type& fd) {
     g *= dx[1]/dx[2];
     lambda *= dx[1]/dx[2];
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<mc[2]; k++) {
+    if (rect) {
+        invrho = hdx[2]/mat.get_rho();
+        g2lam = hdx[2]*(2.*mat.get_g()+mat.get_lambda());
+        g = hdx[2]*mat.get_g();
+        lambda = hdx[2]*mat.get_lambda();
+    }
+    
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
+            for (int k=pmin[2]; k<min(mc[2],pmax[2]); k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[2];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[2];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[2];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[2];
+                if (het) {
+                    invrho = hdx[2]*f.matd[index1];
+                    g2lam = hdx[2]*f.matd[nxd[0]+index1];
+                    g = hdx[2]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[2]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
                 index3 = k-mlb[2]+1;
-                for (int n=0; n<3*(fd.sbporder-1); n++) {
-                    index2 = i*nxd[1]+j*nxd[2]+(mlb[2]+n);
-                    f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                    lambda*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,2,false,diss>(f,index1,i*nxd[1]+j*nxd[2]+mlb[2],1,3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<3*(order-1); n++) {
+                        index2 = i*nxd[1]+j*nxd[2]+(mlb[2]+n);
+                        f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                        lambda*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mc[2]; k<mrb[2]; k++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
+            for (int k=max(mc[2],pmin[2]); k<min(mrb[2],pmax[2]); k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[2];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[2];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[2];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[2];
+                if (het) {
+                    invrho = hdx[2]*f.matd[index1];
+                    g2lam = hdx[2]*f.matd[nxd[0]+index1];
+                    g = hdx[2]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[2]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
-                index3 = 0;
-                for (int n=0; n<2*fd.sbporder-1; n++) {
-                    index2 = index1+(-fd.sbporder+1+n);
-                    f.df[0*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] += (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                    lambda*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] += fd.fdcoeff[index3][n]*g*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] += fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[0][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,2,false,diss>(f,index1,index1-order+1,1,2*order-1,fdc,dc,invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<2*order-1; n++) {
+                        index2 = index1+(-order+1+n);
+                        f.df[0*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] += (invjac*fdc[n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                        lambda*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] += fdc[n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] += fdc[n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] += fdc[n]*g*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] += fdc[n]*(g2lam*f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(dc[n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
         }
     }
     
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mrb[2]; k<prb[2]; k++) {
+    #pragma omp parallel for collapse(2) private(index1, index2, index3, invjac) firstprivate(invrho, g2lam, g, lambda)
+    for (int i=pmin[0]; i<pmax[0]; i++) {
+        for (int j=pmin[1]; j<pmax[1]; j++) {
+            for (int k=max(mrb[2],pmin[2]); k<pmax[2]; k++) {
                 index1 = i*nxd[1]+j*nxd[2]+k;
-                if (f.hetmat) {
-                    invrho = dt/f.mat[index1]/dx[2];
-                    g2lam = dt*(2.*f.mat[2*nxd[0]+index1]+f.mat[nxd[0]+index1])/dx[2];
-                    g = dt*f.mat[2*nxd[0]+index1]/dx[2];
-                    lambda = dt*f.mat[nxd[0]+index1]/dx[2];
+                if (het) {
+                    invrho = hdx[2]*f.matd[index1];
+                    g2lam = hdx[2]*f.matd[nxd[0]+index1];
+                    g = hdx[2]*f.mat[2*nxd[0]+index1];
+                    lambda = hdx[2]*f.mat[nxd[0]+index1];
                 }
-                invjac = invrho/f.jac[index1];
                 index3 = prb[2]-k;
-                for (int n=0; n<3*(fd.sbporder-1); n++) {
-                    index2 = i*nxd[1]+j*nxd[2]+(prb[2]-1-n);
-                    f.df[0*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
-                    f.df[1*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
-                    f.df[2*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
-                                                                                          f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
-                    f.df[3*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                    lambda*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                            f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[index2]);
-                    f.df[5*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[index2]);
-                    f.df[6*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
-                                                                    lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
-                    f.df[7*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                      f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
-                    f.df[8*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
-                                                                    lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
-                                                                            f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
-                    if (dissipation) {
-                        f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
-                        f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
-                        f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
-                        f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
-                        f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
-                        f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
-                        f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
-                        f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
-                        f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                if (rect) {
+                    calc_df_rect<3,2,true,diss>(f,index1,i*nxd[1]+j*nxd[2]+prb[2]-1,-1,3*(order-1),fd.fdcoeff[index3],fd.disscoeff[index3],invrho,g2lam,g,lambda);
+                } else {
+                    invjac = invrho/f.jac[index1];
+                    for (int n=0; n<3*(order-1); n++) {
+                        index2 = i*nxd[1]+j*nxd[2]+(prb[2]-1-n);
+                        f.df[0*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[3*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[5*nxd[0]+index2]));
+                        f.df[1*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[4*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[6*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[7*nxd[0]+index2]));
+                        f.df[2*nxd[0]+index1] -= (invjac*fd.fdcoeff[index3][n]*f.jac[index2]*(f.metric[2*ndim*nxd[0]+index2]*f.f[5*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+1)*nxd[0]+index2]*f.f[7*nxd[0]+index2]+
+                                                                                              f.metric[(2*ndim+2)*nxd[0]+index2]*f.f[8*nxd[0]+index2]));
+                        f.df[3*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                        lambda*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                                f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[4*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[1*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[index2]);
+                        f.df[5*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[2*ndim*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[index2]);
+                        f.df[6*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]+
+                                                                        lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]));
+                        f.df[7*nxd[0]+index1] -= fd.fdcoeff[index3][n]*g*(f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                          f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[nxd[0]+index2]);
+                        f.df[8*nxd[0]+index1] -= fd.fdcoeff[index3][n]*(g2lam*f.metric[(2*ndim+2)*nxd[0]+index1]*f.f[2*nxd[0]+index2]+
+                                                                        lambda*(f.metric[2*ndim*nxd[0]+index1]*f.f[index2]+
+                                                                                f.metric[(2*ndim+1)*nxd[0]+index1]*f.f[nxd[0]+index2]));
+                        if (diss) {
+                            f.df[0*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[0*nxd[0]+index2])/f.jac[index1];
+                            f.df[1*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[1*nxd[0]+index2])/f.jac[index1];
+                            f.df[2*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[2*nxd[0]+index2])/f.jac[index1];
+                            f.df[3*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[3*nxd[0]+index2])/f.jac[index1];
+                            f.df[4*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[4*nxd[0]+index2])/f.jac[index1];
+                            f.df[5*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[5*nxd[0]+index2])/f.jac[index1];
+                            f.df[6*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[6*nxd[0]+index2])/f.jac[index1];
+                            f.df[7*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[7*nxd[0]+index2])/f.jac[index1];
+                            f.df[8*nxd[0]+index1] += cdiss*(fd.disscoeff[index3][n]*f.jac[index2]*f.f[8*nxd[0]+index2])/f.jac[index1];
+                        }
                     }
                 }
             }
@@ -8,10 +8,7 @@
 #include "fd.hpp"
 #include "fields.hpp"
 #include "material.hpp"
-
-struct plastp {
-    double sxx, sxy, sxz, syy, syz, szz, gammap, lambda, epxx, epxy, epxz, epyy, epyz, epzz;
-};
+#include "timer.hpp"
 
 class block
 {
@@ -35,7 +32,17 @@ public:
     double get_x(const int index) const;
     double get_l(const int index) const;
     double get_min_dx(fields& f) const;
-    void calc_df(const double dt, fields& f, const fd_type& fd);
+    bool get_rectilinear() const;
+    double get_rmetric(const int index) const;
+    bool get_fused() const;
+    bool get_active_set() const;
+    long get_active_checked() const;
+    long get_active_total() const;
+    long get_plastic_points() const;
+    void calc_df(const double dt, const double A, fields& f, const fd_type& fd, timer& tm);
+    void calc_df_interior(const double dt, const double A, const double B, fields& f, const fd_type& fd, timer& tm);
+    void calc_df_edges(const double dt, const double A, fields& f, const fd_type& fd, const int depth, timer& tm);
+    void update(const double B, fields& f, const int depth);
     void set_boundaries(const double dt, fields& f);
     void set_mms(const double dt, const double t, fields& f);
     void calc_plastic(const double dt, fields& f);
@@ -47,10 +54,15 @@ private:
     int mrb[3];
     int prb[3];
     int nxd[3];
+    int interior_min[3];
+    int interior_max[3];
+    int halo_ext[3][2];
     double dx[3];
     double x_block[3];
     double l_block[3];
     bool no_data;
+    bool rectilinear;
+    double rmetric[3];
     bool is_plastic;
     bool plastic_tensor;
 	coord c;
@@ -60,16 +72,61 @@ private:
     double xfact;
     bool dissipation;
     double cdiss;
-    void calc_process_info(const cartesian& cart, const int sbporder);
+    std::string simd;
+    int tile[2];
+    bool precomputed;
+    bool fused;
+    bool fused_tiles;
+    int fused_min[3];
+    int fused_max[3];
+    bool active_set;
+    double active_margin;
+    double* active_limit;
+    long active_checked;
+    long active_total;
+    void calc_process_info(const cartesian& cart);
     void set_grid(surface** surf, fields& f, const cartesian& cart, const fd_type& fd);
-    void calc_df_mode2(const double dt, fields& f, const fd_type& fd);
-    void calc_df_mode3(const double dt, fields& f, const fd_type& fd);
-    void calc_df_3d(const double dt, fields& f, const fd_type& fd);
-    void calc_df_szz(const double dt, fields&f, const fd_type& fd);
-    plastp plastic_flow(const double dt, const plastp s_in, const double k, const double g) const;
-    double calc_tau(const plastp s) const;
-    double calc_sigma(const plastp s) const;
-    double yield(const double tau, const double sigma) const;
+    bool check_rectilinear(surface** surf);
+    void calc_df_range(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3], timer& tm);
+    void calc_df_closure(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3], const int cmin[3], const int cmax[3]);
+    void update_range(const double B, fields& f, const int pmin[3], const int pmax[3]);
+    void (block::*calc_df_kernel)(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    void set_kernel(const int sbporder, const bool hetmat);
+    template <int order> void set_kernel_order(const bool hetmat);
+    template <int order, bool het> void set_kernel_diss();
+    template <int order, bool het, bool diss> void set_kernel_grid();
+    template <int order, bool het, bool diss, bool rect> void set_kernel_kind();
+    void (block::*calc_df_central)(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    void set_simd(const std::string simd_in);
+    void set_tile(const int tile_in[2], const int sbporder, const bool hetmat);
+    void set_precomputed(fields& f);
+    void set_fused(const int sbporder);
+    template <int kind, bool rect, int order, bool het, bool diss> void set_kernel_simd();
+    template <int kind, bool rect, int order> void set_central_coeff(const double dt, const fd_type& fd, double* fdc, double* dc, double* coef) const;
+    template <int kind, bool rect, int order, bool het, bool diss, bool pre> void calc_df_central_line(const double dt, const double A, fields& f, const int i, const int j,
+                                                                                                      const int lmin, const int lmax, const double* fdc,
+                                                                                                      const double* dc, const double* coef);
+    template <int kind, bool rect, int order, bool het, bool diss, bool pre, int d> void calc_df_central_dir(const double dt, const double A, fields& f, const int base,
+                                                                                                            const int lmin, const int lmax, const double* fdc,
+                                                                                                            const double* dc, const double* coef);
+    template <int kind, bool rect, int order, bool het, bool diss, bool pre> void calc_df_central_sweep(const double dt, const double A, const double B, fields& f,
+                                                                                                       const int pmin[3], const int pmax[3], const double* fdc,
+                                                                                                       const double* dc, const double* coef);
+    template <int kind, bool rect, int order, bool het, bool diss, bool pre> void calc_df_central_sse2(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    template <int kind, bool rect, int order, bool het, bool diss, bool pre> void calc_df_central_avx2(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    template <int kind, bool rect, int order, bool het, bool diss, bool pre> void calc_df_central_avx512(const double dt, const double A, const double B, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    template <int kind, int d, bool right, bool diss> void calc_df_rect(fields& f, const int index1, const int start, const int step, const int npts,
+                                                                       const double* fc, const double* dcf, const double invrho, const double g2lam,
+                                                                       const double g, const double lambda) const;
+    template <int order, bool het, bool diss, bool rect> void calc_df_mode2(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    template <int order, bool het, bool diss, bool rect> void calc_df_mode3(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    template <int order, bool het, bool diss, bool rect> void calc_df_3d(const double dt, const double A, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    void calc_df_szz(const double dt, fields& f, const fd_type& fd, const int pmin[3], const int pmax[3]);
+    void (block::*calc_plastic_kernel)(const double dt, fields& f);
+    void set_plastic_kernel(const bool hetmat);
+    void set_active_set(fields& f);
+    template <int kind> void set_plastic_kernel_kind(const bool hetmat);
+    template <int kind, bool tensor, bool het> void calc_plastic_batch(const double dt, fields& f);
     void calc_mms_mode3(const double dt, const double t, fields& f);
     void calc_mms_mode2(const double dt, const double t, fields& f);
     void calc_mms_3d(const double dt, const double t, fields& f);
@@ -13,7 +13,8 @@
 using namespace std;
 
 boundary::boundary(const int ndim_in, const int mode_in, const string material_in, const int location_in, const std::string boundtype_in,
-                   const coord c, const double dx[3], fields& f, material& m, const cartesian& cart, const fd_type& fd) {
+                   const coord c, const double dx[3], const bool rectilinear, const double rmetric[3], fields& f, material& m,
+                   const cartesian& cart, const fd_type& fd) {
     // constructor
     
     assert(ndim_in == 2 || ndim_in == 3);
@@ -158,7 +159,7 @@ boundary::boundary(const int ndim_in, const int mode_in, const string material_i
     
     // allocate memory for arrays for normal vectors and grid spacing
     
-    allocate_normals(dx,f,fd);
+    allocate_normals(dx,rectilinear,rmetric,f,fd);
 
 }
 
@@ -170,7 +171,7 @@ boundary::~boundary() {
     deallocate_normals();
 }
 
-void boundary::allocate_normals(const double dx[3], fields& f, const fd_type& fd) {
+void boundary::allocate_normals(const double dx[3], const bool rectilinear, const double rmetric[3], fields& f, const fd_type& fd) {
     // allocate memory and assign normal vectors and grid spacing
     
     nx = new double** [ndim];
@@ -198,7 +199,14 @@ void boundary::allocate_normals(const double dx[3], fields& f, const fd_type& fd
     for (int i=0; i<n_loc[0]; i++) {
         for (int j=0; j<n_loc[1]; j++) {
             dl[i][j] = 0.;
-            if (location == 0 || location == 1) {
+            if (rectilinear) {
+                // rectilinear block, normal is a coordinate direction and metric is not stored
+                for (int k=0; k<ndim; k++) {
+                    nx[k][i][j] = 0.;
+                }
+                nx[location/2][i][j] = 1.;
+                dl[i][j] = rmetric[location/2]/(fd.get_h0()*dx[location/2]);
+            } else if (location == 0 || location == 1) {
                 for (int k=0; k<ndim; k++) {
                     dl[i][j] += pow(f.metric[0*ndim*nxd[0]+k*nxd[0]+mlb[0]*nxd[1]+(i+mlb[1])*nxd[2]+j+mlb[2]],2);
                     nx[k][i][j] = f.metric[0*ndim*nxd[0]+k*nxd[0]+mlb[0]*nxd[1]+(i+mlb[1])*nxd[2]+j+mlb[2]];
@@ -302,14 +310,14 @@ void boundary::apply_bcs(const double dt, fields& f) {
                 
                 if (f.hetmat) {
                     if (ndim == 2 && mode == 3) {
-                        cs = sqrt(f.mat[1*nxd[0]+index]/f.mat[index]);
-                        zs = f.mat[index]*cs;
+                        cs = f.matd[3*nxd[0]+index];
+                        zs = f.matd[5*nxd[0]+index];
                     } else {
-                        cp = sqrt((f.mat[1*nxd[0]+index]+2.*f.mat[2*nxd[0]+index])/f.mat[index]);
-                        cs = sqrt(f.mat[2*nxd[0]+index]/f.mat[index]);
-                        zp = f.mat[index]*cp;
-                        zs = f.mat[index]*cs;
-                        gamma = 1.-2.*pow(cs/cp,2);
+                        cp = f.matd[2*nxd[0]+index];
+                        cs = f.matd[3*nxd[0]+index];
+                        zp = f.matd[4*nxd[0]+index];
+                        zs = f.matd[5*nxd[0]+index];
+                        gamma = f.matd[6*nxd[0]+index];
                     }
                 }
                 
@@ -501,68 +509,3 @@ boundchar boundary::calc_hat(const boundchar b, const double z) {
    
    return b_out;
 }
-
-boundfields rotate_xy_nt(const boundfields b, const double nn[3], const double t1[3],
-                                   const double t2[3]) {
-    // rotates xyz fields to normal/tangent fields
-    
-    boundfields b_out;
-    
-    b_out.v1 = nn[0]*b.v1+nn[1]*b.v2+nn[2]*b.v3;
-    b_out.v2 = t1[0]*b.v1+t1[1]*b.v2+t1[2]*b.v3;
-    b_out.v3 = t2[0]*b.v1+t2[1]*b.v2+t2[2]*b.v3;
-
-    b_out.s11 = (nn[0]*(b.s11*nn[0]+b.s12*nn[1]+b.s13*nn[2])+
-                 nn[1]*(b.s12*nn[0]+b.s22*nn[1]+b.s23*nn[2])+
-                 nn[2]*(b.s13*nn[0]+b.s23*nn[1]+b.s33*nn[2]));
-    b_out.s12 = (nn[0]*(b.s11*t1[0]+b.s12*t1[1]+b.s13*t1[2])+
-                 nn[1]*(b.s12*t1[0]+b.s22*t1[1]+b.s23*t1[2])+
-                 nn[2]*(b.s13*t1[0]+b.s23*t1[1]+b.s33*t1[2]));
-    b_out.s13 = (nn[0]*(b.s11*t2[0]+b.s12*t2[1]+b.s13*t2[2])+
-                 nn[1]*(b.s12*t2[0]+b.s22*t2[1]+b.s23*t2[2])+
-                 nn[2]*(b.s13*t2[0]+b.s23*t2[1]+b.s33*t2[2]));
-    b_out.s22 = (t1[0]*(b.s11*t1[0]+b.s12*t1[1]+b.s13*t1[2])+
-                 t1[1]*(b.s12*t1[0]+b.s22*t1[1]+b.s23*t1[2])+
-                 t1[2]*(b.s13*t1[0]+b.s23*t1[1]+b.s33*t1[2]));
-    b_out.s23 = (t1[0]*(b.s11*t2[0]+b.s12*t2[1]+b.s13*t2[2])+
-                 t1[1]*(b.s12*t2[0]+b.s22*t2[1]+b.s23*t2[2])+
-                 t1[2]*(b.s13*t2[0]+b.s23*t2[1]+b.s33*t2[2]));
-    b_out.s33 = (t2[0]*(b.s11*t2[0]+b.s12*t2[1]+b.s13*t2[2])+
-                 t2[1]*(b.s12*t2[0]+b.s22*t2[1]+b.s23*t2[2])+
-                 t2[2]*(b.s13*t2[0]+b.s23*t2[1]+b.s33*t2[2]));
-    
-    return b_out;
-}
-
-boundfields rotate_nt_xy(const boundfields b, const double nn[3], const double t1[3],
-                                   const double t2[3]) {
-    // rotates xyz fields to normal/tangent fields
-    
-    boundfields b_out;
-    
-    b_out.v1 = nn[0]*b.v1+t1[0]*b.v2+t2[0]*b.v3;
-    b_out.v2 = nn[1]*b.v1+t1[1]*b.v2+t2[1]*b.v3;
-    b_out.v3 = nn[2]*b.v1+t1[2]*b.v2+t2[2]*b.v3;
-    
-    b_out.s11 = (nn[0]*(b.s11*nn[0]+b.s12*t1[0]+b.s13*t2[0])+
-                 t1[0]*(b.s12*nn[0]+b.s22*t1[0]+b.s23*t2[0])+
-                 t2[0]*(b.s13*nn[0]+b.s23*t1[0]+b.s33*t2[0]));
-    b_out.s12 = (nn[0]*(b.s11*nn[1]+b.s12*t1[1]+b.s13*t2[1])+
-                 t1[0]*(b.s12*nn[1]+b.s22*t1[1]+b.s23*t2[1])+
-                 t2[0]*(b.s13*nn[1]+b.s23*t1[1]+b.s33*t2[1]));
-    b_out.s13 = (nn[0]*(b.s11*nn[2]+b.s12*t1[2]+b.s13*t2[2])+
-                 t1[0]*(b.s12*nn[2]+b.s22*t1[2]+b.s23*t2[2])+
-                 t2[0]*(b.s13*nn[2]+b.s23*t1[2]+b.s33*t2[2]));
-    b_out.s22 = (nn[1]*(b.s11*nn[1]+b.s12*t1[1]+b.s13*t2[1])+
-                 t1[1]*(b.s12*nn[1]+b.s22*t1[1]+b.s23*t2[1])+
-                 t2[1]*(b.s13*nn[1]+b.s23*t1[1]+b.s33*t2[1]));
-    b_out.s23 = (nn[1]*(b.s11*nn[2]+b.s12*t1[2]+b.s13*t2[2])+
-                 t1[1]*(b.s12*nn[2]+b.s22*t1[2]+b.s23*t2[2])+
-                 t2[1]*(b.s13*nn[2]+b.s23*t1[2]+b.s33*t2[2]));
-    b_out.s33 = (nn[2]*(b.s11*nn[2]+b.s12*t1[2]+b.s13*t2[2])+
-                 t1[2]*(b.s12*nn[2]+b.s22*t1[2]+b.s23*t2[2])+
-                 t2[2]*(b.s13*nn[2]+b.s23*t1[2]+b.s33*t2[2]));
-
-    
-    return b_out;
-}
@@ -13,19 +13,104 @@ struct boundfields {
     double v1, v2, v3, s11, s12, s13, s22, s23, s33;
 };
 
+struct boundframe {
+    double n1, n2, n3, t11, t12, t13, t21, t22, t23;
+};
+
 struct boundchar {
     double v, s;
 };
 
-boundfields rotate_xy_nt(const boundfields b, const double nn[3], const double t1[3], const double t2[3]);
+inline boundfields rotate_xy_nt(const boundfields b, const boundframe r) {
+    // rotates xyz fields to normal/tangent fields
+    // defined in header so that loops over interface and boundary points can inline and vectorize the rotation
+    // frame is passed by value as scalars, as arrays declared inside simd loops are not vectorized
+    
+    boundfields b_out;
+    
+    b_out.v1 = r.n1*b.v1+r.n2*b.v2+r.n3*b.v3;
+    b_out.v2 = r.t11*b.v1+r.t12*b.v2+r.t13*b.v3;
+    b_out.v3 = r.t21*b.v1+r.t22*b.v2+r.t23*b.v3;
+
+    b_out.s11 = (r.n1*(b.s11*r.n1+b.s12*r.n2+b.s13*r.n3)+
+                 r.n2*(b.s12*r.n1+b.s22*r.n2+b.s23*r.n3)+
+                 r.n3*(b.s13*r.n1+b.s23*r.n2+b.s33*r.n3));
+    b_out.s12 = (r.n1*(b.s11*r.t11+b.s12*r.t12+b.s13*r.t13)+
+                 r.n2*(b.s12*r.t11+b.s22*r.t12+b.s23*r.t13)+
+                 r.n3*(b.s13*r.t11+b.s23*r.t12+b.s33*r.t13));
+    b_out.s13 = (r.n1*(b.s11*r.t21+b.s12*r.t22+b.s13*r.t23)+
+                 r.n2*(b.s12*r.t21+b.s22*r.t22+b.s23*r.t23)+
+                 r.n3*(b.s13*r.t21+b.s23*r.t22+b.s33*r.t23));
+    b_out.s22 = (r.t11*(b.s11*r.t11+b.s12*r.t12+b.s13*r.t13)+
+                 r.t12*(b.s12*r.t11+b.s22*r.t12+b.s23*r.t13)+
+                 r.t13*(b.s13*r.t11+b.s23*r.t12+b.s33*r.t13));
+    b_out.s23 = (r.t11*(b.s11*r.t21+b.s12*r.t22+b.s13*r.t23)+
+                 r.t12*(b.s12*r.t21+b.s22*r.t22+b.s23*r.t23)+
+                 r.t13*(b.s13*r.t21+b.s23*r.t22+b.s33*r.t23));
+    b_out.s33 = (r.t21*(b.s11*r.t21+b.s12*r.t22+b.s13*r.t23)+
+                 r.t22*(b.s12*r.t21+b.s22*r.t22+b.s23*r.t23)+
+                 r.t23*(b.s13*r.t21+b.s23*r.t22+b.s33*r.t23));
+    
+    return b_out;
+}
+
+inline boundfields rotate_nt_xy(const boundfields b, const boundframe r) {
+    // rotates normal/tangent fields to xyz fields
+    
+    boundfields b_out;
+    
+    b_out.v1 = r.n1*b.v1+r.t11*b.v2+r.t21*b.v3;
+    b_out.v2 = r.n2*b.v1+r.t12*b.v2+r.t22*b.v3;
+    b_out.v3 = r.n3*b.v1+r.t13*b.v2+r.t23*b.v3;
+    
+    b_out.s11 = (r.n1*(b.s11*r.n1+b.s12*r.t11+b.s13*r.t21)+
+                 r.t11*(b.s12*r.n1+b.s22*r.t11+b.s23*r.t21)+
+                 r.t21*(b.s13*r.n1+b.s23*r.t11+b.s33*r.t21));
+    b_out.s12 = (r.n1*(b.s11*r.n2+b.s12*r.t12+b.s13*r.t22)+
+                 r.t11*(b.s12*r.n2+b.s22*r.t12+b.s23*r.t22)+
+                 r.t21*(b.s13*r.n2+b.s23*r.t12+b.s33*r.t22));
+    b_out.s13 = (r.n1*(b.s11*r.n3+b.s12*r.t13+b.s13*r.t23)+
+                 r.t11*(b.s12*r.n3+b.s22*r.t13+b.s23*r.t23)+
+                 r.t21*(b.s13*r.n3+b.s23*r.t13+b.s33*r.t23));
+    b_out.s22 = (r.n2*(b.s11*r.n2+b.s12*r.t12+b.s13*r.t22)+
+                 r.t12*(b.s12*r.n2+b.s22*r.t12+b.s23*r.t22)+
+                 r.t22*(b.s13*r.n2+b.s23*r.t12+b.s33*r.t22));
+    b_out.s23 = (r.n2*(b.s11*r.n3+b.s12*r.t13+b.s13*r.t23)+
+                 r.t12*(b.s12*r.n3+b.s22*r.t13+b.s23*r.t23)+
+                 r.t22*(b.s13*r.n3+b.s23*r.t13+b.s33*r.t23));
+    b_out.s33 = (r.n3*(b.s11*r.n3+b.s12*r.t13+b.s13*r.t23)+
+                 r.t13*(b.s12*r.n3+b.s22*r.t13+b.s23*r.t23)+
+                 r.t23*(b.s13*r.n3+b.s23*r.t13+b.s33*r.t23));
+    
+    return b_out;
+}
+
+inline boundframe make_frame(const double nn[3], const double t1[3], const double t2[3]) {
+    // packs normal and tangent vectors into a frame
+    
+    const boundframe r = {nn[0], nn[1], nn[2], t1[0], t1[1], t1[2], t2[0], t2[1], t2[2]};
+    
+    return r;
+}
+
+inline boundfields rotate_xy_nt(const boundfields b, const double nn[3], const double t1[3], const double t2[3]) {
+    // rotates xyz fields to normal/tangent fields
+    
+    return rotate_xy_nt(b, make_frame(nn,t1,t2));
+}
 
-boundfields rotate_nt_xy(const boundfields b, const double nn[3], const double t1[3], const double t2[3]);
+inline boundfields rotate_nt_xy(const boundfields b, const double nn[3], const double t1[3], const double t2[3]) {
+    // rotates normal/tangent fields to xyz fields
+    
+    return rotate_nt_xy(b, make_frame(nn,t1,t2));
+}
 
 class boundary
 {
 public:
     boundary(const int ndim_in, const int mode_in, const std::string material_in, const int location_in, const std::string boundtype_in,
-             const coord c, const double dx[3], fields& f, material& m, const cartesian& cart, const fd_type& fd);
+             const coord c, const double dx[3], const bool rectilinear, const double rmetric[3], fields& f, material& m,
+             const cartesian& cart, const fd_type& fd);
     ~boundary();
     virtual void apply_bcs(const double dt, fields& f);
 private:
@@ -50,7 +135,7 @@ private:
     double r;
     double alpha;
     double theta;
-    void allocate_normals(const double dx[3], fields& f, const fd_type& fd);
+    void allocate_normals(const double dx[3], const bool rectilinear, const double rmetric[3], fields& f, const fd_type& fd);
     void deallocate_normals();
     boundchar calc_hat(const boundchar b, const double z);
 };
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cassert>
+#include <cmath>
 #include <string>
 #include "cartesian.hpp"
 #include "coord.hpp"
@@ -8,7 +10,8 @@
 
 using namespace std;
 
-cartesian::cartesian(const char* filename, const int ndim_in, const int nx_in[3], const int nblocks[3], int** nx_block, int** xm_block, const int sbporder) {
+cartesian::cartesian(const char* filename, const int ndim_in, const int nx_in[3], const int nblocks[3], int** nx_block, int** xm_block,
+                     const int nifaces, const string* iftype, const string material, const int sbporder, const int nstages) {
     // constructor
     // sets up domain decomposition and holds process-specific information
 	
@@ -20,6 +23,16 @@ cartesian::cartesian(const char* filename, const int ndim_in, const int nx_in[3]
 	int reorder;
 	int periods[3];
 	
+    // default ghost cell exchange method, exchange at every RK stage
+    
+    exchange = "nonblocking";
+    string halo_in = "";
+    halo = 1;
+    
+    // default decomposition, split grid points evenly among processes
+    
+    decomposition = "uniform";
+    
     // open input file, find appropriate place and read in parameters if present
     
     string line;
@@ -39,6 +52,26 @@ cartesian::cartesian(const char* filename, const int ndim_in, const int nx_in[3]
                     nproc[i] = 1;
                 }
             }
+            // optional ghost cell exchange method on following line
+            getline(paramfile,line);
+            if (getline(paramfile,line)) {
+                string method;
+                stringstream ss(line);
+                ss >> method;
+                if (method.length() > 0 && method[0] != '[') {
+                    exchange = method;
+                    ss >> halo_in;
+                    // optional decomposition method on following line
+                    if (getline(paramfile,line)) {
+                        string decomp_in;
+                        stringstream ss2(line);
+                        ss2 >> decomp_in;
+                        if (decomp_in.length() > 0 && decomp_in[0] != '[') {
+                            decomposition = decomp_in;
+                        }
+                    }
+                }
+            }
         } else {
             nproc[0] = 0;
             nproc[1] = 0;
@@ -72,6 +105,33 @@ cartesian::cartesian(const char* filename, const int ndim_in, const int nx_in[3]
         nproc[2] = 0;
     }
     
+    if (exchange != "nonblocking" && exchange != "persistent" && exchange != "neighbor" &&
+        exchange != "shared") {
+        if (id == 0) {
+            cout << "Unknown ghost cell exchange method " << exchange << ". Defaulting to nonblocking\n";
+        }
+        exchange = "nonblocking";
+    }
+    
+    // deep halo exchanges ghost cells once per time step rather than once per RK stage
+    
+    if (halo_in == "deep") {
+        if (exchange == "nonblocking" || exchange == "persistent") {
+            halo = nstages;
+        } else if (id == 0) {
+            cout << "Deep halo requires nonblocking or persistent exchange. Exchanging at every RK stage\n";
+        }
+    } else if (halo_in.length() > 0 && id == 0) {
+        cout << "Unknown ghost cell depth " << halo_in << ". Exchanging at every RK stage\n";
+    }
+    
+    if (decomposition != "uniform" && decomposition != "weighted") {
+        if (id == 0) {
+            cout << "Unknown decomposition method " << decomposition << ". Defaulting to uniform\n";
+        }
+        decomposition = "uniform";
+    }
+    
     // set up arrays for process info
     
     for (int i=0; i<3; i++) {
@@ -118,6 +178,63 @@ cartesian::cartesian(const char* filename, const int ndim_in, const int nx_in[3]
 		}
 	}
     
+    // weighted decomposition places process boundaries to balance estimated cost rather than grid points
+    // cost per grid point is estimated from material type and interface type
+    
+    int* ifdir = 0;
+    int** ifblock = 0;
+    double* ifcost = 0;
+    double bulkcost = 1.;
+    
+    if (decomposition == "weighted") {
+        if (material == "plastic") {
+            bulkcost = 1.5;
+        }
+        ifdir = new int [nifaces];
+        ifblock = new int* [nifaces];
+        ifcost = new double [nifaces];
+        for (int n=0; n<nifaces; n++) {
+            ifblock[n] = new int [3];
+            stringstream ssif;
+            ssif << n;
+            string direction_in;
+            ifstream iffile(filename, ifstream::in);
+            while (getline(iffile,line)) {
+                if (line == "[fdfault.interface"+ssif.str()+"]") {
+                    break;
+                }
+            }
+            if (iffile.eof()) {
+                cerr << "Error reading interface "+ssif.str()+" from input file\n";
+                MPI_Abort(MPI_COMM_WORLD,-1);
+            }
+            iffile >> direction_in;
+            for (int i=0; i<3; i++) {
+                iffile >> ifblock[n][i];
+            }
+            iffile.close();
+            if (direction_in == "x") {
+                ifdir[n] = 0;
+            } else if (direction_in == "y") {
+                ifdir[n] = 1;
+            } else {
+                ifdir[n] = 2;
+            }
+            // rough cost of each interface point relative to an elastic grid point, including the extra boundary
+            // stencils in the adjacent blocks
+            if (iftype[n] == "locked") {
+                ifcost[n] = 8.;
+            } else if (iftype[n] == "frictionless") {
+                ifcost[n] = 12.;
+            } else if (iftype[n] == "slipweak") {
+                ifcost[n] = 16.;
+            } else {
+                ifcost[n] = 24.;
+            }
+        }
+        weighted_split(nx_block, xm_block, nifaces, ifdir, ifblock, ifcost, bulkcost);
+    }
+    
     // move boundary if very close to the edge of a block
 	
 	for (int i=0; i<ndim; i++) {
@@ -163,7 +280,197 @@ cartesian::cartesian(const char* filename, const int ndim_in, const int nx_in[3]
             MPI_Abort(MPI_COMM_WORLD,-1);
         }
     }
+    
+    if (decomposition == "weighted") {
+        print_decomposition(nx_block, xm_block, nifaces, ifdir, ifblock, ifcost, bulkcost);
+        for (int n=0; n<nifaces; n++) {
+            delete[] ifblock[n];
+        }
+        delete[] ifdir;
+        delete[] ifblock;
+        delete[] ifcost;
+    }
+    
+    // with a deep halo, ghost regions are deep enough for all RK stages of a time step, and ghost points
+    // within the halo are computed redundantly by this process
+    // only used if ghost points lie away from block edges (so they only need interior stencils) and
+    // no interfaces or boundaries in other directions cross process boundaries
+    
+    if (halo > 1) {
+        int deep = 1, deep_all;
+        const int g = sbporder-1;
+        const int depth = halo*g;
+        for (int i=0; i<ndim; i++) {
+            if (nproc[i] == 1) { continue; }
+            for (int j=0; j<ndim; j++) {
+                if (j != i && nblocks[j] > 1) {
+                    deep = 0;
+                }
+            }
+            if (c.get_nx_loc(i) < depth) {
+                deep = 0;
+            }
+            if (coords[i] == 0) { continue; }
+            for (int j=0; j<nblocks[i]; j++) {
+                if (c.get_xm_loc(i) == xm_block[i][j]) {
+                    deep = 0;
+                } else if (c.get_xm_loc(i) > xm_block[i][j] && c.get_xm_loc(i) < xm_block[i][j]+nx_block[i][j]) {
+                    if (c.get_xm_loc(i)-xm_block[i][j] < depth+g || xm_block[i][j]+nx_block[i][j]-c.get_xm_loc(i) < depth+g) {
+                        deep = 0;
+                    }
+                }
+            }
+        }
+        
+        MPI_Allreduce(&deep, &deep_all, 1, MPI_INT, MPI_MIN, comm);
+        
+        if (deep_all == 1) {
+            for (int i=0; i<ndim; i++) {
+                if (c.get_xm_ghost(i) == g) {
+                    c.set_xm_ghost(i,depth);
+                }
+                if (c.get_xp_ghost(i) == g) {
+                    c.set_xp_ghost(i,depth);
+                }
+            }
+        } else {
+            if (id == 0) {
+                cout << "Process boundaries too close to block edges or interfaces for deep halo. Exchanging at every RK stage\n";
+            }
+            halo = 1;
+        }
+    }
+
+}
+
+double cartesian::box_cost(const int lo[3], const int hi[3], int** nx_block, int** xm_block, const int nifaces, const int* ifdir,
+                           int** ifblock, const double* ifcost, const double bulkcost) const {
+    // estimated cost of updating grid points with global indices from lo to hi-1
+    // interface points are assigned to the first grid point in the block on the plus side
+    
+    double cost = bulkcost;
+    
+    for (int i=0; i<ndim; i++) {
+        cost *= (double)(hi[i]-lo[i]);
+    }
+    
+    for (int n=0; n<nifaces; n++) {
+        const int d = ifdir[n];
+        const int p = xm_block[d][ifblock[n][d]+1];
+        if (p < lo[d] || p >= hi[d]) {
+            continue;
+        }
+        double ifpoints = ifcost[n];
+        for (int i=0; i<ndim; i++) {
+            if (i == d) {
+                continue;
+            }
+            const int b = ifblock[n][i];
+            const int bmin = (lo[i] > xm_block[i][b]) ? lo[i] : xm_block[i][b];
+            const int bmax = (hi[i] < xm_block[i][b]+nx_block[i][b]) ? hi[i] : xm_block[i][b]+nx_block[i][b];
+            ifpoints *= (bmax > bmin) ? (double)(bmax-bmin) : 0.;
+        }
+        cost += ifpoints;
+    }
+    
+    return cost;
+}
+
+void cartesian::weighted_split(int** nx_block, int** xm_block, const int nifaces, const int* ifdir,
+                               int** ifblock, const double* ifcost, const double bulkcost) {
+    // places process boundaries in each direction so that all processes have approximately equal estimated cost
+    // cost is summed over planes normal to each direction, so the decomposition remains a Cartesian grid
+    
+    int lo[3], hi[3];
+    
+    for (int i=0; i<ndim; i++) {
+        if (nproc[i] == 1) {
+            continue;
+        }
+        const int n = c.get_nx(i);
+        double* cumcost = new double [n+1];
+        int* bound = new int [nproc[i]+1];
+        for (int j=0; j<ndim; j++) {
+            lo[j] = 0;
+            hi[j] = c.get_nx(j);
+        }
+        cumcost[0] = 0.;
+        for (int p=0; p<n; p++) {
+            lo[i] = p;
+            hi[i] = p+1;
+            cumcost[p+1] = cumcost[p]+box_cost(lo, hi, nx_block, xm_block, nifaces, ifdir, ifblock, ifcost, bulkcost);
+        }
+        // choose boundary closest to target cost, leaving at least one point for each process
+        bound[0] = 0;
+        for (int m=1; m<nproc[i]; m++) {
+            const double target = cumcost[n]*(double)m/(double)nproc[i];
+            int b = bound[m-1]+1;
+            while (b < n-nproc[i]+m && fabs(cumcost[b+1]-target) <= fabs(cumcost[b]-target)) {
+                b++;
+            }
+            bound[m] = b;
+        }
+        bound[nproc[i]] = n;
+        c.set_nx_loc(i,bound[coords[i]+1]-bound[coords[i]]);
+        c.set_xm_loc(i,bound[coords[i]]);
+        delete[] cumcost;
+        delete[] bound;
+    }
+}
 
+void cartesian::print_decomposition(int** nx_block, int** xm_block, const int nifaces, const int* ifdir,
+                                    int** ifblock, const double* ifcost, const double bulkcost) const {
+    // prints process boundaries and predicted load imbalance (maximum over mean of estimated cost)
+    
+    int lo[3], hi[3];
+    int loc[6];
+    int* loc_all = 0;
+    double cost, cost_max, cost_sum;
+    
+    for (int i=0; i<3; i++) {
+        lo[i] = c.get_xm_loc(i);
+        hi[i] = c.get_xm_loc(i)+c.get_nx_loc(i);
+        loc[i] = (i < ndim) ? coords[i] : 0;
+        loc[3+i] = c.get_xm_loc(i);
+    }
+    
+    cost = box_cost(lo, hi, nx_block, xm_block, nifaces, ifdir, ifblock, ifcost, bulkcost);
+    
+    MPI_Allreduce(&cost, &cost_max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(&cost, &cost_sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    
+    if (id == 0) {
+        loc_all = new int [6*np];
+    }
+    
+    MPI_Gather(loc, 6, MPI_INT, loc_all, 6, MPI_INT, 0, MPI_COMM_WORLD);
+    
+    if (id == 0) {
+        const char dirname[3] = {'x', 'y', 'z'};
+        cout << "Weighted domain decomposition, first grid point of each process:\n";
+        for (int i=0; i<ndim; i++) {
+            int* start = new int [nproc[i]];
+            for (int n=0; n<np; n++) {
+                bool first = true;
+                for (int j=0; j<ndim; j++) {
+                    if (j != i && loc_all[6*n+j] != 0) {
+                        first = false;
+                    }
+                }
+                if (first) {
+                    start[loc_all[6*n+i]] = loc_all[6*n+3+i];
+                }
+            }
+            cout << "  " << dirname[i] << ":";
+            for (int n=0; n<nproc[i]; n++) {
+                cout << " " << start[n];
+            }
+            cout << "\n";
+            delete[] start;
+        }
+        cout << "Predicted load imbalance (maximum/mean estimated cost): " << cost_max*(double)np/cost_sum << "\n";
+        delete[] loc_all;
+    }
 }
 
 int cartesian::get_nproc(const int direction) const {
@@ -245,3 +552,9 @@ int cartesian::get_max_loc(const int index) const {
     
     return c.get_max_loc(index);
 }
+
+int cartesian::get_halo() const {
+    // returns number of RK stages covered by each ghost cell exchange
+    
+    return halo;
+}
@@ -1,13 +1,15 @@
 #ifndef CARTESIANCLASSHEADERDEF
 #define CARTESIANCLASSHEADERDEF
 
+#include <string>
 #include "coord.hpp"
 #include <mpi.h>
 
 class cartesian
 { friend class fields;
 public:
-	cartesian(const char* filename, const int ndim_in, const int nx_in[3], const int nblocks[3], int** nx_block, int** xm_block, const int sbporder);
+	cartesian(const char* filename, const int ndim_in, const int nx_in[3], const int nblocks[3], int** nx_block, int** xm_block,
+              const int nifaces, const std::string* iftype, const std::string material, const int sbporder, const int nstages);
 	int get_nproc(const int direction) const;
 	int get_coords(const int direction) const;
 	int get_nx(const int index) const;
@@ -19,6 +21,7 @@ public:
     int get_xp_ghost(const int index) const;
     int get_min_loc(const int index) const;
     int get_max_loc(const int index) const;
+    int get_halo() const;
 private:
 	int np;
 	int id;
@@ -26,7 +29,16 @@ private:
 	coord c;
 	int nproc[3];
 	int coords[3];
-	MPI_Comm comm;	
+	std::string exchange;
+	int halo;
+	std::string decomposition;
+	MPI_Comm comm;
+    double box_cost(const int lo[3], const int hi[3], int** nx_block, int** xm_block, const int nifaces, const int* ifdir,
+                    int** ifblock, const double* ifcost, const double bulkcost) const;
+    void weighted_split(int** nx_block, int** xm_block, const int nifaces, const int* ifdir,
+                        int** ifblock, const double* ifcost, const double bulkcost);
+    void print_decomposition(int** nx_block, int** xm_block, const int nifaces, const int* ifdir,
+                             int** ifblock, const double* ifcost, const double bulkcost) const;
 };
 
 #endif
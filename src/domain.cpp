@@ -12,11 +12,12 @@
 #include "rk.hpp"
 #include "slipweak.hpp"
 #include "stz.hpp"
+#include "timer.hpp"
 #include <mpi.h>
 
 using namespace std;
 
-domain::domain(const char* filename) {
+domain::domain(const char* filename, const int nstages) {
     // constructor, no default as need to allocate memory
     
     int sbporder;
@@ -119,7 +120,7 @@ domain::domain(const char* filename) {
     
 	// set up cartesian type to hold domain decomposition information
 	
-	cart = new cartesian(filename, ndim, nx, nblocks, nx_block, xm_block, sbporder);
+	cart = new cartesian(filename, ndim, nx, nblocks, nx_block, xm_block, nifaces, iftype, material, sbporder, nstages);
     
     f = new fields(filename, ndim, mode, material, *cart);
 	
@@ -127,10 +128,20 @@ domain::domain(const char* filename) {
     
     allocate_blocks(filename, nx_block, xm_block);
     
+    // RK stage execution is set in the operator section, which is the same for all blocks
+    
+    fused = blocks[0][0][0]->get_fused();
+    
+    // plastic active set is set in the fields section, which is also the same for all blocks
+    
+    active_set = blocks[0][0][0]->get_active_set();
+    nplastic = 0;
+    
     // exchange neighbors to fill in ghost cells
     
     f->exchange_neighbors();
     f->exchange_grid();
+    f->write_memory_info();
     
     // allocate memory and create interfaces
     
@@ -225,58 +236,148 @@ double domain::get_min_dx() const {
     return dxmin_all;
 }
 
-void domain::do_rk_stage(const double dt, const int stage, const double t, rk_type& rk) {
+void domain::do_rk_stage(const double dt, const int stage, const double t, rk_type& rk, timer& tm) {
     // advances domain fields for one RK stage of one time step
     
+    // with a deep halo, ghost cells are only exchanged on the first stage of each time step, and
+    // depth is the number of ghost layers that must be computed redundantly during this stage
+    
+    const int halo = cart->get_halo();
+    const bool exchange = (stage%halo == 0);
+    const int depth = (halo-1-stage%halo)*(fd->get_sbporder()-1);
+    
+    // with a fused stage, blocks scale df by the RK coefficient as it is computed and update the fields themselves,
+    // starting while df is still being computed, rather than in separate passes over the full arrays
+    
+    const double A = (fused) ? rk.get_A(stage) : 1.;
+    const double B = (fused) ? rk.get_B(stage) : 0.;
+    
+    // start exchanging ghost cells with neighbors
+    
+    if (exchange) {
+        tm.start(timer::exchange);
+        f->start_exchange();
+        tm.stop(timer::exchange);
+    }
+    
     // scale df by RK coefficient
     
-    f->scale_df(rk.get_A(stage));
+    tm.start(timer::scale_df);
+    
+    if (!fused) {
+        f->scale_df(rk.get_A(stage));
+    }
     
     for (int i=0; i<nifaces; i++) {
         interfaces[i]->scale_df(rk.get_A(stage));
     }
     
-    // calculate df for blocks
+    tm.stop(timer::scale_df);
+    
+    // calculate df for block interiors while ghost cells are in transit
+    
+    tm.start(timer::calc_df);
+    
+    for (int i=0; i<nblocks[0]; i++) {
+        for (int j=0; j<nblocks[1]; j++) {
+            for (int k=0; k<nblocks[2]; k++) {
+                blocks[i][j][k]->calc_df_interior(dt,A,B,*f,*fd,tm);
+            }
+        }
+    }
+    
+    tm.stop(timer::calc_df);
+    
+    // finish exchange and calculate df for points near process boundaries
+    
+    if (exchange) {
+        tm.start(timer::exchange);
+        f->finish_exchange();
+        tm.stop(timer::exchange);
+    }
+    
+    tm.start(timer::calc_df);
     
     for (int i=0; i<nblocks[0]; i++) {
         for (int j=0; j<nblocks[1]; j++) {
             for (int k=0; k<nblocks[2]; k++) {
-                blocks[i][j][k]->calc_df(dt,*f,*fd);
+                blocks[i][j][k]->calc_df_edges(dt,A,*f,*fd,depth,tm);
 //                blocks[i][j][k]->set_mms(dt, t+rk.get_C(stage)*dt, *f);
+            }
+        }
+    }
+    
+    tm.stop(timer::calc_df);
+    
+    // apply boundary conditions
+    
+    tm.start(timer::set_boundaries);
+    
+    for (int i=0; i<nblocks[0]; i++) {
+        for (int j=0; j<nblocks[1]; j++) {
+            for (int k=0; k<nblocks[2]; k++) {
                 blocks[i][j][k]->set_boundaries(dt,*f);
             }
         }
     }
+    
+    tm.stop(timer::set_boundaries);
         
     // apply interface conditions
     
+    tm.start(timer::iface_bcs);
+    
     for (int i=0; i<nifaces; i++) {
         interfaces[i]->apply_bcs(dt,t+rk.get_C(stage)*dt,*f,false);
     }
     
+    tm.stop(timer::iface_bcs);
+    
     // calculate df for interfaces
     
+    tm.start(timer::iface_calc_df);
+    
     for (int i=0; i<nifaces; i++) {
         interfaces[i]->calc_df(dt);
     }
     
+    tm.stop(timer::iface_calc_df);
+    
     // update interfaces
     
+    tm.start(timer::iface_update);
+    
     for (int i=0; i<nifaces; i++) {
         interfaces[i]->update(rk.get_B(stage));
     }
     
+    tm.stop(timer::iface_update);
+    
     // update fields
     
-    f->update(rk.get_B(stage));
+    tm.start(timer::update);
+    
+    if (fused) {
+        for (int i=0; i<nblocks[0]; i++) {
+            for (int j=0; j<nblocks[1]; j++) {
+                for (int k=0; k<nblocks[2]; k++) {
+                    blocks[i][j][k]->update(B,*f,depth);
+                }
+            }
+        }
+    } else {
+        f->update(rk.get_B(stage));
+    }
+    
+    tm.stop(timer::update);
     
     // if last stage and response is plastic, solve plasticity equations
     
     if (stage+1 == rk.get_nstages() && is_plastic) {
         
-        // set absolute stress
+        tm.start(timer::plastic);
         
-        f->set_stress();
+        // plasticity kernels add the initial stress to the stress changes as they are loaded
         
         for (int i=0; i<nblocks[0]; i++) {
             for (int j=0; j<nblocks[1]; j++) {
@@ -286,37 +387,62 @@ void domain::do_rk_stage(const double dt, const int stage, const double t, rk_ty
             }
         }
         
-        // subtract stress
+        nplastic++;
         
-        f->remove_stress();
+        tm.stop(timer::plastic);
     
         // apply interface conditions to correctly set slip rates (needed for correct output)
         
+        tm.start(timer::iface_bcs);
+        
         for (int i=0; i<nifaces; i++) {
             interfaces[i]->apply_bcs(dt,t+rk.get_C(stage)*dt,*f,true);
         }
         
+        tm.stop(timer::iface_bcs);
+        
     }
-    
-    // exchange neighbors
-    
-    f->exchange_neighbors();
 
 }
 
-void domain::free_exchange() {
-    // frees MPI datatypes for ghost cell exchange
-    f->free_exchange();
+void domain::write_exchange_info() const {
+    // prints ghost cell exchange statistics
+    f->write_exchange_info();
 }
 
-void domain::set_stress() {
-    // sets absolute stress
-    f->set_stress();
+void domain::write_plastic_info() const {
+    // prints number of points where plasticity was checked in the last time step and on average if using the active set
+    
+    if (!active_set) { return; }
+    
+    int id;
+    long counts[3] = {0, 0, 0}, counts_all[3];
+    
+    MPI_Comm_rank(MPI_COMM_WORLD, &id);
+    
+    for (int i=0; i<nblocks[0]; i++) {
+        for (int j=0; j<nblocks[1]; j++) {
+            for (int k=0; k<nblocks[2]; k++) {
+                counts[0] += blocks[i][j][k]->get_active_checked();
+                counts[1] += blocks[i][j][k]->get_active_total();
+                counts[2] += blocks[i][j][k]->get_plastic_points();
+            }
+        }
+    }
+    
+    MPI_Reduce(counts, counts_all, 3, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    
+    if (id == 0 && counts_all[2] > 0 && nplastic > 0) {
+        cout << "Plastic active set: " << counts_all[0] << " of " << counts_all[2] << " points checked ("
+             << 100.*(double)counts_all[0]/(double)counts_all[2] << "%, "
+             << 100.*(double)counts_all[1]/(double)counts_all[2]/(double)nplastic << "% on average)\n";
+    }
+    
 }
 
-void domain::remove_stress() {
-    // subtracts initial stress
-    f->remove_stress();
+void domain::free_exchange() {
+    // frees MPI datatypes for ghost cell exchange
+    f->free_exchange();
 }
 
 void domain::allocate_blocks(const char* filename, int** nx_block, int** xm_block) {
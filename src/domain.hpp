@@ -9,13 +9,14 @@
 #include "friction.hpp"
 #include "interface.hpp"
 #include "rk.hpp"
+#include "timer.hpp"
 
 class domain
 { friend class outputunit;
     friend class frontlist;
     friend class front;
 public:
-    domain(const char* filename);
+    domain(const char* filename, const int nstages);
     ~domain();
     int get_ndim() const;
     int get_mode() const;
@@ -23,15 +24,18 @@ public:
 	int get_nblockstot() const;
     int get_nifaces() const;
     double get_min_dx() const;
-    void do_rk_stage(const double dt, const int stage, const double t, rk_type& rk);
+    void do_rk_stage(const double dt, const int stage, const double t, rk_type& rk, timer& tm);
+    void write_exchange_info() const;
+    void write_plastic_info() const;
     void free_exchange();
-    void set_stress();
-    void remove_stress();
 private:
 	int ndim;
     int mode;
     std::string material;
     bool is_plastic;
+    bool fused;
+    bool active_set;
+    int nplastic;
 	int nx[3];
 	int nblockstot;
     int nblocks[3];
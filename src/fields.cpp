@@ -1,6 +1,8 @@
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <cmath>
+#include <limits>
 #include <string.h>
 #include <sstream>
 #include "cartesian.hpp"
@@ -39,6 +41,15 @@ fields::fields(const char* filename, const int ndim_in, const int mode_in, const
             paramfile >> loadfile;
             paramfile >> matfile;
             paramfile >> plastic_tensor;
+            // optional yield margin threshold for the plastic active set on following line (0 checks all points)
+            plastic_margin = 0.;
+            getline(paramfile,line);
+            if (getline(paramfile,line)) {
+                stringstream ssm(line);
+                if (!(ssm >> plastic_margin)) {
+                    plastic_margin = 0.;
+                }
+            }
         }
     } else {
         cerr << "Error opening input file in fields.cpp\n";
@@ -61,6 +72,11 @@ fields::fields(const char* filename, const int ndim_in, const int mode_in, const
         nmat = 2;
     }
     
+    // bound on stress changes is only accumulated if plasticity is checked using the active set
+    
+    track_stress = (material == "plastic" && plastic_margin > 0.);
+    stress_change = 0.;
+    
 	if (material == "elastic") {
 		nfieldsp = 0;
 	} else {
@@ -91,11 +107,35 @@ fields::fields(const char* filename, const int ndim_in, const int mode_in, const
     ndatajac = c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2);
     nxyz = c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2);
     
-    f = new double [ndataf];
+    // with shared memory exchange, fields are allocated in a window visible to all processes on the node
+    
+    exchange = cart.exchange;
+    
+    if (exchange == "shared") {
+        MPI_Info info;
+        MPI_Info_create(&info);
+        MPI_Info_set(info, "alloc_shared_noncontig", "true");
+        MPI_Comm_split_type(cart.comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &nodecomm);
+        MPI_Win_allocate_shared((MPI_Aint)ndataf*sizeof(fieldreal), sizeof(fieldreal), info, nodecomm, &f, &win);
+        MPI_Info_free(&info);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    } else {
+        f = new fieldreal [ndataf];
+    }
 	df = new double [ndatadf];
-    x = new double [ndatax];
-    metric = new double [ndatametric];
-    jac = new double [ndatajac];
+    x = new gridreal [ndatax];
+    
+    // metric and jacobian are only allocated if a block on this process is not rectilinear
+    
+    has_metric = false;
+    metric = 0;
+    jac = 0;
+    
+    // precomputed grid coefficients are only allocated if requested for a 3D curvilinear block on this process
+    
+    has_precomputed = false;
+    jmetric = 0;
+    smetric = 0;
     
     // set fields to zero
     
@@ -165,11 +205,23 @@ fields::fields(const char* filename, const int ndim_in, const int mode_in, const
 
 fields::~fields() {
     
-    delete[] f;
+    // shared memory window is freed in free_exchange, as it must be released before MPI is finalized
+    
+    if (exchange != "shared") {
+        delete[] f;
+    }
 	delete[] df;
     delete[] x;
-    delete[] metric;
-    delete[] jac;
+    
+    if (has_metric) {
+        delete[] metric;
+        delete[] jac;
+    }
+    
+    if (has_precomputed) {
+        delete[] jmetric;
+        delete[] smetric;
+    }
     
     if (hetstress) {
         delete[] s;
@@ -177,48 +229,11 @@ fields::~fields() {
     
     if (hetmat) {
         delete[] mat;
+        delete[] matd;
     }
 	
 }
 
-void fields::set_stress() {
-	// initialize fields to constant initial stress state
-    
-	for (int i=0; i<ns; i++) {
-        for (int j=0; j<nxyz; j++) {
-            f[(nv+i)*nxyz+j] += s0[index[i]];
-        }
-	}
-    
-    if (!hetstress) { return; }
-    
-    for (int i=0; i<ns; i++) {
-        for (int j=0; j<nxyz; j++) {
-            f[(nv+i)*nxyz+j] += s[i*nxyz+j];
-        }
-    }
-		
-}
-
-void fields::remove_stress() {
-    // initialize fields to constant initial stress state
-    
-    for (int i=0; i<ns; i++) {
-        for (int j=0; j<nxyz; j++) {
-            f[(nv+i)*nxyz+j] -= s0[index[i]];
-        }
-    }
-    
-    if (!hetstress) { return; }
-    
-    for (int i=0; i<ns; i++) {
-        for (int j=0; j<nxyz; j++) {
-            f[(nv+i)*nxyz+j] -= s[i*nxyz+j];
-        }
-    }
-    
-}
-
 void fields::init_exchange(const cartesian& cart) {
 	// copy cartesian parameters
 	
@@ -231,27 +246,62 @@ void fields::init_exchange(const cartesian& cart) {
 		MPI_Cart_shift(comm,i,-1,&shiftm_source[i],&shiftm_dest[i]);
 	}
 	
-	// set up strided arrays for sending
+	// allocate contiguous buffers for packing ghost cell layers
+	// only points owned by this process are sent in the directions normal to the exchange, except with
+	// a deep halo, where directions are exchanged in turn including ghost cells so that corners are filled
 	
-	MPI_Type_vector(nfields,c.get_xp_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-					MPI_DOUBLE,&slicep[0]);
-	MPI_Type_commit(&slicep[0]);
+	halo = cart.get_halo();
 	
-	MPI_Type_vector(nfields,c.get_xm_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-					MPI_DOUBLE,&slicem[0]);
-	MPI_Type_commit(&slicem[0]);
-    
-    MPI_Type_vector(nfields*c.get_nx_tot(0),c.get_xp_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&slicep[1]);
-    MPI_Type_commit(&slicep[1]);
+	for (int i=0; i<3; i++) {
+		nbufp[i] = nfields*c.get_xp_ghost(i);
+		nbufm[i] = nfields*c.get_xm_ghost(i);
+		for (int j=0; j<3; j++) {
+			if (j != i) {
+				nbufp[i] *= (halo > 1) ? c.get_nx_tot(j) : c.get_nx_loc(j);
+				nbufm[i] *= (halo > 1) ? c.get_nx_tot(j) : c.get_nx_loc(j);
+			}
+		}
+		sendbufp[i] = new fieldreal [nbufp[i]];
+		sendbufm[i] = new fieldreal [nbufm[i]];
+		recvbufp[i] = new fieldreal [nbufp[i]];
+		recvbufm[i] = new fieldreal [nbufm[i]];
+		pack_time[i] = 0.;
+		unpack_time[i] = 0.;
+	}
 	
-    MPI_Type_vector(nfields*c.get_nx_tot(0),c.get_xm_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&slicem[1]);
-    MPI_Type_commit(&slicem[1]);
-    
-    MPI_Type_vector(nfields*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xp_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&slicep[2]);
-    MPI_Type_commit(&slicep[2]);
+	nexchange = 0;
 	
-	MPI_Type_vector(nfields*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xm_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&slicem[2]);
-    MPI_Type_commit(&slicem[2]);
+	for (int i=0; i<6; i++) {
+		nbr_shared[i] = false;
+	}
+	done_pending = false;
+	
+	// set up exchange method
+	
+	if (exchange == "shared") {
+		init_shared();
+	} else if (exchange == "persistent") {
+		// persistent requests are created once and restarted for every exchange
+		for (int i=0; i<ndim; i++) {
+			MPI_Recv_init(recvbufm[i], nbufm[i], MPI_FIELDREAL, shiftp_source[i], 2*i, comm, &recv_req[2*i]);
+			MPI_Recv_init(recvbufp[i], nbufp[i], MPI_FIELDREAL, shiftm_source[i], 2*i+1, comm, &recv_req[2*i+1]);
+			MPI_Send_init(sendbufp[i], nbufp[i], MPI_FIELDREAL, shiftp_dest[i], 2*i, comm, &send_req[2*i]);
+			MPI_Send_init(sendbufm[i], nbufm[i], MPI_FIELDREAL, shiftm_dest[i], 2*i+1, comm, &send_req[2*i+1]);
+		}
+	} else if (exchange == "neighbor") {
+		// neighborhood collective on cartesian topology, neighbors are ordered minus then plus side for each dimension
+		// buffer addresses are absolute, so buffers are passed relative to MPI_BOTTOM
+		for (int i=0; i<ndim; i++) {
+			MPI_Get_address(sendbufm[i], &sdispls[2*i]);
+			MPI_Get_address(sendbufp[i], &sdispls[2*i+1]);
+			MPI_Get_address(recvbufm[i], &rdispls[2*i]);
+			MPI_Get_address(recvbufp[i], &rdispls[2*i+1]);
+			counts[2*i] = nbufm[i];
+			counts[2*i+1] = nbufp[i];
+			types[2*i] = MPI_FIELDREAL;
+			types[2*i+1] = MPI_FIELDREAL;
+		}
+	}
 	
 	// set up indices for destination in fields array
 	
@@ -273,26 +323,470 @@ void fields::init_exchange(const cartesian& cart) {
 	
 }
 
+void fields::pack(const int direction, const int start, const int width, fieldreal* buf) const {
+    // copies ghost cell layers normal to direction from fields array into contiguous buffer
+    
+    if (width == 0) { return; }
+    
+    int lo[3], hi[3];
+    
+    for (int i=0; i<3; i++) {
+        if (i == direction) {
+            lo[i] = start;
+            hi[i] = start+width;
+        } else if (halo > 1) {
+            lo[i] = 0;
+            hi[i] = c.get_nx_tot(i);
+        } else {
+            lo[i] = c.get_xm_ghost(i);
+            hi[i] = c.get_max_loc(i);
+        }
+    }
+    
+    const int n0 = hi[0]-lo[0], n1 = hi[1]-lo[1], n2 = hi[2]-lo[2];
+    
+    #pragma omp parallel for collapse(3)
+    for (int l=0; l<nfields; l++) {
+        for (int i=0; i<n0; i++) {
+            for (int j=0; j<n1; j++) {
+                const int index = l*nxyz+(i+lo[0])*c.get_nx_tot(1)*c.get_nx_tot(2)+(j+lo[1])*c.get_nx_tot(2)+lo[2];
+                const int bindex = ((l*n0+i)*n1+j)*n2;
+                for (int k=0; k<n2; k++) {
+                    buf[bindex+k] = f[index+k];
+                }
+            }
+        }
+    }
+    
+}
+
+void fields::unpack(const int direction, const int start, const int width, const fieldreal* buf) {
+    // copies contiguous buffer into ghost cell layers normal to direction in fields array
+    
+    if (width == 0) { return; }
+    
+    int lo[3], hi[3];
+    
+    for (int i=0; i<3; i++) {
+        if (i == direction) {
+            lo[i] = start;
+            hi[i] = start+width;
+        } else if (halo > 1) {
+            lo[i] = 0;
+            hi[i] = c.get_nx_tot(i);
+        } else {
+            lo[i] = c.get_xm_ghost(i);
+            hi[i] = c.get_max_loc(i);
+        }
+    }
+    
+    const int n0 = hi[0]-lo[0], n1 = hi[1]-lo[1], n2 = hi[2]-lo[2];
+    
+    #pragma omp parallel for collapse(3)
+    for (int l=0; l<nfields; l++) {
+        for (int i=0; i<n0; i++) {
+            for (int j=0; j<n1; j++) {
+                const int index = l*nxyz+(i+lo[0])*c.get_nx_tot(1)*c.get_nx_tot(2)+(j+lo[1])*c.get_nx_tot(2)+lo[2];
+                const int bindex = ((l*n0+i)*n1+j)*n2;
+                for (int k=0; k<n2; k++) {
+                    f[index+k] = buf[bindex+k];
+                }
+            }
+        }
+    }
+    
+}
+
+void fields::init_shared() {
+    // find neighbors on the same node and get pointers to their fields in the shared memory window
+    // neighbors also exchange array dimensions and the first owned layer that is copied into ghost cells
+    // sides are ordered minus then plus neighbor for each dimension
+    
+    MPI_Group cartgroup, nodegroup;
+    int nbr[6], nbr_node[6], info_send[6][4], info_recv[6][4];
+    
+    MPI_Comm_group(comm, &cartgroup);
+    MPI_Comm_group(nodecomm, &nodegroup);
+    
+    for (int i=0; i<6; i++) {
+        nbr[i] = MPI_PROC_NULL;
+        nbr_shared[i] = false;
+        nbr_f[i] = 0;
+        nbr_start[i] = 0;
+        for (int j=0; j<4; j++) {
+            info_send[i][j] = 0;
+            info_recv[i][j] = 0;
+        }
+    }
+    
+    for (int i=0; i<ndim; i++) {
+        nbr[2*i] = shiftp_source[i];
+        nbr[2*i+1] = shiftm_source[i];
+        for (int j=0; j<3; j++) {
+            info_send[2*i][j] = c.get_nx_tot(j);
+            info_send[2*i+1][j] = c.get_nx_tot(j);
+        }
+        info_send[2*i][3] = c.get_xm_ghost(i);
+        info_send[2*i+1][3] = c.get_max_loc(i)-c.get_xp_ghost(i);
+    }
+    
+    for (int i=0; i<6; i++) {
+        if (nbr[i] == MPI_PROC_NULL) {
+            nbr_node[i] = MPI_UNDEFINED;
+        } else {
+            MPI_Group_translate_ranks(cartgroup, 1, &nbr[i], nodegroup, &nbr_node[i]);
+        }
+    }
+    
+    MPI_Group_free(&cartgroup);
+    MPI_Group_free(&nodegroup);
+    
+    // info for minus neighbor describes the layers it copies into its plus ghost cells, and vice versa
+    
+    for (int i=0; i<ndim; i++) {
+        MPI_Sendrecv(info_send[2*i+1], 4, MPI_INT, shiftp_dest[i], 2*i, info_recv[2*i], 4, MPI_INT, shiftp_source[i], 2*i,
+                     comm, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(info_send[2*i], 4, MPI_INT, shiftm_dest[i], 2*i+1, info_recv[2*i+1], 4, MPI_INT, shiftm_source[i], 2*i+1,
+                     comm, MPI_STATUS_IGNORE);
+    }
+    
+    for (int i=0; i<2*ndim; i++) {
+        for (int j=0; j<3; j++) {
+            nbr_nx[i][j] = info_recv[i][j];
+        }
+        nbr_start[i] = info_recv[i][3];
+        if (nbr_node[i] != MPI_UNDEFINED) {
+            MPI_Aint size;
+            int disp_unit;
+            nbr_shared[i] = true;
+            MPI_Win_shared_query(win, nbr_node[i], &size, &disp_unit, &nbr_f[i]);
+        }
+    }
+    
+    done_pending = false;
+    
+}
+
+void fields::copy_shared(const int side) {
+    // copies owned layers of a neighbor on the same node directly into ghost cells
+    // layout in the directions normal to the exchange is the same on both processes
+    
+    const int direction = side/2;
+    int start, width;
+    
+    if (side%2 == 0) {
+        start = 0;
+        width = c.get_xm_ghost(direction);
+    } else {
+        start = c.get_max_loc(direction);
+        width = c.get_xp_ghost(direction);
+    }
+    
+    if (width == 0) { return; }
+    
+    int lo[3], hi[3], shift[3];
+    
+    for (int i=0; i<3; i++) {
+        if (i == direction) {
+            lo[i] = start;
+            hi[i] = start+width;
+            shift[i] = nbr_start[side]-start;
+        } else {
+            lo[i] = c.get_xm_ghost(i);
+            hi[i] = c.get_max_loc(i);
+            shift[i] = 0;
+        }
+    }
+    
+    const int n0 = hi[0]-lo[0], n1 = hi[1]-lo[1], n2 = hi[2]-lo[2];
+    const int nbr_nxyz = nbr_nx[side][0]*nbr_nx[side][1]*nbr_nx[side][2];
+    const fieldreal* nf = nbr_f[side];
+    
+    #pragma omp parallel for collapse(3)
+    for (int l=0; l<nfields; l++) {
+        for (int i=0; i<n0; i++) {
+            for (int j=0; j<n1; j++) {
+                const int index = l*nxyz+(i+lo[0])*c.get_nx_tot(1)*c.get_nx_tot(2)+(j+lo[1])*c.get_nx_tot(2)+lo[2];
+                const int nindex = (l*nbr_nxyz+(i+lo[0]+shift[0])*nbr_nx[side][1]*nbr_nx[side][2]
+                                    +(j+lo[1]+shift[1])*nbr_nx[side][2]+lo[2]+shift[2]);
+                for (int k=0; k<n2; k++) {
+                    f[index+k] = nf[nindex+k];
+                }
+            }
+        }
+    }
+    
+}
+
+void fields::wait_shared() {
+    // waits for neighbors on the same node to finish copying from this process before fields are modified
+    
+    if (exchange == "shared" && done_pending) {
+        MPI_Waitall(4*ndim, done_req, MPI_STATUSES_IGNORE);
+        done_pending = false;
+    }
+    
+}
+
+void fields::start_exchange_direction(const int direction) {
+    // post receives, then pack and send ghost cell layers to neighbors in a single direction
+    
+    double t0;
+    const int i = direction;
+    
+    if (exchange == "persistent") {
+        MPI_Startall(2, &recv_req[2*i]);
+    } else {
+        MPI_Irecv(recvbufm[i], nbufm[i], MPI_FIELDREAL, shiftp_source[i], 2*i, comm, &recv_req[2*i]);
+        MPI_Irecv(recvbufp[i], nbufp[i], MPI_FIELDREAL, shiftm_source[i], 2*i+1, comm, &recv_req[2*i+1]);
+    }
+    
+    t0 = MPI_Wtime();
+    pack(i, c.get_max_loc(i)-c.get_xp_ghost(i), c.get_xp_ghost(i), sendbufp[i]);
+    pack(i, c.get_xm_ghost(i), c.get_xm_ghost(i), sendbufm[i]);
+    pack_time[i] += MPI_Wtime()-t0;
+    
+    if (exchange == "persistent") {
+        MPI_Startall(2, &send_req[2*i]);
+    } else {
+        MPI_Isend(sendbufp[i], nbufp[i], MPI_FIELDREAL, shiftp_dest[i], 2*i, comm, &send_req[2*i]);
+        MPI_Isend(sendbufm[i], nbufm[i], MPI_FIELDREAL, shiftm_dest[i], 2*i+1, comm, &send_req[2*i+1]);
+    }
+    
+}
+
+void fields::finish_exchange_direction(const int direction) {
+    // wait for exchange in a single direction to complete and unpack ghost cells
+    
+    double t0;
+    const int i = direction;
+    
+    MPI_Waitall(2, &recv_req[2*i], MPI_STATUSES_IGNORE);
+    MPI_Waitall(2, &send_req[2*i], MPI_STATUSES_IGNORE);
+    
+    t0 = MPI_Wtime();
+    unpack(i, 0, c.get_xm_ghost(i), recvbufm[i]);
+    unpack(i, c.get_max_loc(i), c.get_xp_ghost(i), recvbufp[i]);
+    unpack_time[i] += MPI_Wtime()-t0;
+    
+}
+
+void fields::start_exchange() {
+    // post receives, then pack and send ghost cell layers to neighbors
+    // neighbors on the same node with shared memory exchange only receive an empty message once fields are ready
+    // with a deep halo, directions are exchanged in turn and only the first is started here
+    // ghost cells must not be used until finish_exchange returns
+    
+    double t0;
+    
+    if (halo > 1) {
+        start_exchange_direction(0);
+        nexchange++;
+        return;
+    }
+    
+    if (exchange == "shared") {
+        MPI_Win_sync(win);
+    }
+    
+    if (exchange == "persistent") {
+        MPI_Startall(2*ndim, recv_req);
+    } else if (exchange == "nonblocking" || exchange == "shared") {
+        for (int i=0; i<ndim; i++) {
+            MPI_Irecv(recvbufm[i], (nbr_shared[2*i]) ? 0 : nbufm[i], MPI_FIELDREAL, shiftp_source[i], 2*i, comm, &recv_req[2*i]);
+            MPI_Irecv(recvbufp[i], (nbr_shared[2*i+1]) ? 0 : nbufp[i], MPI_FIELDREAL, shiftm_source[i], 2*i+1, comm, &recv_req[2*i+1]);
+        }
+    }
+    
+    for (int i=0; i<ndim; i++) {
+        t0 = MPI_Wtime();
+        if (!nbr_shared[2*i+1]) {
+            pack(i, c.get_max_loc(i)-c.get_xp_ghost(i), c.get_xp_ghost(i), sendbufp[i]);
+        }
+        if (!nbr_shared[2*i]) {
+            pack(i, c.get_xm_ghost(i), c.get_xm_ghost(i), sendbufm[i]);
+        }
+        pack_time[i] += MPI_Wtime()-t0;
+        if (exchange == "nonblocking" || exchange == "shared") {
+            MPI_Isend(sendbufp[i], (nbr_shared[2*i+1]) ? 0 : nbufp[i], MPI_FIELDREAL, shiftp_dest[i], 2*i, comm, &send_req[2*i]);
+            MPI_Isend(sendbufm[i], (nbr_shared[2*i]) ? 0 : nbufm[i], MPI_FIELDREAL, shiftm_dest[i], 2*i+1, comm, &send_req[2*i+1]);
+        }
+    }
+    
+    if (exchange == "persistent") {
+        MPI_Startall(2*ndim, send_req);
+    } else if (exchange == "neighbor") {
+        MPI_Ineighbor_alltoallw(MPI_BOTTOM, counts, sdispls, types, MPI_BOTTOM, counts, rdispls, types, comm, &recv_req[0]);
+    }
+    
+    nexchange++;
+    
+}
+
+void fields::finish_exchange() {
+    // wait for exchange of fields with neighbors to complete and unpack ghost cells
+    // ghost cells from neighbors on the same node are copied directly from shared memory
+    
+    double t0;
+    
+    if (halo > 1) {
+        for (int i=0; i<ndim; i++) {
+            if (i > 0) {
+                start_exchange_direction(i);
+            }
+            finish_exchange_direction(i);
+        }
+        return;
+    }
+    
+    if (exchange == "neighbor") {
+        MPI_Wait(&recv_req[0], MPI_STATUS_IGNORE);
+    } else {
+        MPI_Waitall(2*ndim, recv_req, MPI_STATUSES_IGNORE);
+        MPI_Waitall(2*ndim, send_req, MPI_STATUSES_IGNORE);
+    }
+    
+    if (exchange == "shared") {
+        MPI_Win_sync(win);
+    }
+    
+    for (int i=0; i<ndim; i++) {
+        t0 = MPI_Wtime();
+        if (nbr_shared[2*i]) {
+            copy_shared(2*i);
+        } else {
+            unpack(i, 0, c.get_xm_ghost(i), recvbufm[i]);
+        }
+        if (nbr_shared[2*i+1]) {
+            copy_shared(2*i+1);
+        } else {
+            unpack(i, c.get_max_loc(i), c.get_xp_ghost(i), recvbufp[i]);
+        }
+        unpack_time[i] += MPI_Wtime()-t0;
+    }
+    
+    // notify neighbors on the same node that copying is complete, checked before fields are next modified
+    
+    if (exchange == "shared") {
+        for (int i=0; i<ndim; i++) {
+            done_req[4*i] = MPI_REQUEST_NULL;
+            done_req[4*i+1] = MPI_REQUEST_NULL;
+            done_req[4*i+2] = MPI_REQUEST_NULL;
+            done_req[4*i+3] = MPI_REQUEST_NULL;
+            if (nbr_shared[2*i]) {
+                MPI_Isend(0, 0, MPI_DOUBLE, shiftm_dest[i], 6+2*i, comm, &done_req[4*i]);
+                MPI_Irecv(0, 0, MPI_DOUBLE, shiftp_source[i], 7+2*i, comm, &done_req[4*i+1]);
+            }
+            if (nbr_shared[2*i+1]) {
+                MPI_Isend(0, 0, MPI_DOUBLE, shiftp_dest[i], 7+2*i, comm, &done_req[4*i+2]);
+                MPI_Irecv(0, 0, MPI_DOUBLE, shiftm_source[i], 6+2*i, comm, &done_req[4*i+3]);
+            }
+        }
+        done_pending = true;
+    }
+    
+}
+
+void fields::write_memory_info() const {
+    // prints memory used for fields, grid, and precomputed grid coefficients, summed over all processes
+    
+    int id;
+    double bytes[2], bytes_all[2];
+    
+    MPI_Comm_rank(comm, &id);
+    
+    bytes[0] = (double)sizeof(fieldreal)*(double)ndataf+(double)sizeof(double)*(double)ndatadf+(double)sizeof(gridreal)*(double)ndatax;
+    
+    if (has_metric) {
+        bytes[0] += (double)sizeof(gridreal)*(double)(ndatametric+ndatajac);
+    }
+    
+    if (hetmat) {
+        bytes[0] += (double)sizeof(double)*(double)((nmat+nmatd)*nxyz);
+    }
+    
+    if (hetstress) {
+        bytes[0] += (double)sizeof(double)*(double)(ns*nxyz);
+    }
+    
+    bytes[1] = 0.;
+    
+    if (has_precomputed) {
+        bytes[1] += (double)sizeof(gridreal)*(double)(4*ndatametric);
+    }
+    
+    MPI_Reduce(bytes, bytes_all, 2, MPI_DOUBLE, MPI_SUM, 0, comm);
+    
+    if (id == 0) {
+        cout << "Memory for fields and grid: " << bytes_all[0]/1048576. << " MB\n";
+        if (bytes_all[1] > 0.) {
+            cout << "Memory for precomputed grid coefficients: " << bytes_all[1]/1048576. << " MB\n";
+        }
+    }
+    
+}
+
+void fields::write_exchange_info() const {
+    // prints bytes sent per exchange and time spent packing and unpacking buffers in each direction
+    // unpack time includes copies from neighbors on the same node for shared memory exchange
+    // bytes are summed over all processes, times are maximum over all processes
+    
+    int id;
+    double bytes[3], bytes_all[3], shared_bytes[3], shared_bytes_all[3], times[6], times_all[6];
+    const string dirs[3] = {"x", "y", "z"};
+    
+    MPI_Comm_rank(comm, &id);
+    
+    for (int i=0; i<3; i++) {
+        bytes[i] = 0.;
+        shared_bytes[i] = 0.;
+        if (nbr_shared[2*i]) {
+            shared_bytes[i] += (double)sizeof(fieldreal)*(double)nbufm[i];
+        } else {
+            bytes[i] += (double)sizeof(fieldreal)*(double)nbufm[i];
+        }
+        if (nbr_shared[2*i+1]) {
+            shared_bytes[i] += (double)sizeof(fieldreal)*(double)nbufp[i];
+        } else {
+            bytes[i] += (double)sizeof(fieldreal)*(double)nbufp[i];
+        }
+        times[2*i] = pack_time[i];
+        times[2*i+1] = unpack_time[i];
+    }
+    
+    MPI_Reduce(bytes, bytes_all, 3, MPI_DOUBLE, MPI_SUM, 0, comm);
+    MPI_Reduce(shared_bytes, shared_bytes_all, 3, MPI_DOUBLE, MPI_SUM, 0, comm);
+    MPI_Reduce(times, times_all, 6, MPI_DOUBLE, MPI_MAX, 0, comm);
+    
+    if (id == 0) {
+        cout << "Ghost cell exchange (" << exchange;
+        if (halo > 1) {
+            cout << ", deep halo covering " << halo << " RK stages";
+        }
+        cout << ", " << nexchange << " exchanges):\n";
+        for (int i=0; i<ndim; i++) {
+            cout << "  " << dirs[i] << ": " << bytes_all[i] << " bytes sent per exchange, ";
+            if (exchange == "shared") {
+                cout << shared_bytes_all[i] << " bytes copied in shared memory, ";
+            }
+            cout << "pack time " << times_all[2*i] << " s, unpack time " << times_all[2*i+1] << " s\n";
+        }
+    }
+    
+}
+
 void fields::exchange_neighbors() {
 	// exchange fields with neighbors
 	
-	MPI_Status status;
-	
-	// exchange neighbors as needed
-	
-	for (int i=0; i<ndim; i++) {
-		MPI_Sendrecv(&f[shiftp_source_index[i]], 1, slicep[i], shiftp_dest[i], 2*i,
-					 &f[shiftp_dest_index[i]], 1, slicem[i], shiftp_source[i], 2*i, comm, &status);
-        MPI_Sendrecv(&f[shiftm_source_index[i]], 1, slicem[i], shiftm_dest[i], 2*i+1,
-                     &f[shiftm_dest_index[i]], 1, slicep[i], shiftm_source[i], 2*i+1, comm, &status);
-	}
-
+    start_exchange();
+    finish_exchange();
 	
 }
 
 void fields::scale_df(const double A) {
     // scales df by RK coefficient A
     
+    #pragma omp parallel for
     for (int i=0; i<ndatadf; i++) {
         df[i] *= A;
     }
@@ -301,9 +795,81 @@ void fields::scale_df(const double A) {
 
 void fields::update(const double B) {
     // calculates second part of a RK time step (update fields)
+    // for the plastic active set, also accumulates a bound on the change in any stress component, including
+    // the roundoff in storing the updated stress
     
-    for (int i=0; i<ndatadf; i++) {
-        f[i] += B*df[i];
+    wait_shared();
+    
+    if (!track_stress) {
+        #pragma omp parallel for
+        for (int i=0; i<ndatadf; i++) {
+            f[i] += B*df[i];
+        }
+        return;
+    }
+    
+    const double eps = numeric_limits<fieldreal>::epsilon();
+    double dsmax = 0.;
+    
+    #pragma omp parallel
+    {
+        #pragma omp for nowait
+        for (int i=0; i<nv*nxyz; i++) {
+            f[i] += B*df[i];
+        }
+        #pragma omp for reduction(max:dsmax)
+        for (int i=nv*nxyz; i<ndatadf; i++) {
+            f[i] += B*df[i];
+            const double ds = fabs(B*df[i])+eps*fabs(f[i]);
+            dsmax = (ds > dsmax) ? ds : dsmax;
+        }
+    }
+    
+    stress_change += dsmax;
+    
+}
+
+void fields::allocate_metric() {
+    // allocates memory for metric derivatives and jacobian
+    // called by blocks with curved surfaces, rectilinear blocks do not use these arrays
+    
+    if (has_metric) { return; }
+    
+    has_metric = true;
+    
+    metric = new gridreal [ndatametric];
+    jac = new gridreal [ndatajac];
+    
+    for (int i=0; i<ndatametric; i++) {
+        metric[i] = 0.;
+    }
+    
+    for (int i=0; i<ndatajac; i++) {
+        jac[i] = 0.;
+    }
+    
+}
+
+void fields::allocate_precomputed() {
+    // allocates memory for precomputed grid coefficients used by the 3D curvilinear interior kernels
+    // jmetric holds the jacobian times the metric, set once the grid has been exchanged
+    // smetric holds the metric scaled by the material properties, set by each block for its own points
+    
+    if (has_precomputed) { return; }
+    
+    assert(has_metric);
+    
+    has_precomputed = true;
+    
+    jmetric = new gridreal [ndatametric];
+    smetric = new gridreal [3*ndatametric];
+    
+    for (int i=0; i<ndatametric; i++) {
+        jmetric[i] = 0.;
+    }
+    
+    for (int i=0; i<3*ndatametric; i++) {
+        smetric[i] = 0.;
     }
     
 }
@@ -318,23 +884,23 @@ void fields::exchange_grid() {
     // set up strided arrays for sending x data
     
     MPI_Type_vector(ndim,c.get_xp_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-                    MPI_DOUBLE,&gridslicep[0]);
+                    MPI_GRIDREAL,&gridslicep[0]);
     MPI_Type_commit(&gridslicep[0]);
     
     MPI_Type_vector(ndim,c.get_xm_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-                    MPI_DOUBLE,&gridslicem[0]);
+                    MPI_GRIDREAL,&gridslicem[0]);
     MPI_Type_commit(&gridslicem[0]);
     
-    MPI_Type_vector(ndim*c.get_nx_tot(0),c.get_xp_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&gridslicep[1]);
+    MPI_Type_vector(ndim*c.get_nx_tot(0),c.get_xp_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_GRIDREAL,&gridslicep[1]);
     MPI_Type_commit(&gridslicep[1]);
     
-    MPI_Type_vector(ndim*c.get_nx_tot(0),c.get_xm_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&gridslicem[1]);
+    MPI_Type_vector(ndim*c.get_nx_tot(0),c.get_xm_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_GRIDREAL,&gridslicem[1]);
     MPI_Type_commit(&gridslicem[1]);
     
-    MPI_Type_vector(ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xp_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&gridslicep[2]);
+    MPI_Type_vector(ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xp_ghost(2),c.get_nx_tot(2),MPI_GRIDREAL,&gridslicep[2]);
     MPI_Type_commit(&gridslicep[2]);
     
-    MPI_Type_vector(ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xm_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&gridslicem[2]);
+    MPI_Type_vector(ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xm_ghost(2),c.get_nx_tot(2),MPI_GRIDREAL,&gridslicem[2]);
     MPI_Type_commit(&gridslicem[2]);
     
     // exchange x data
@@ -355,35 +921,63 @@ void fields::exchange_grid() {
     MPI_Type_free(&gridslicep[1]);
     MPI_Type_free(&gridslicep[2]);
     
+    // exchange flags indicating if neighbors have allocated metric and jacobian
+    // only exchange with neighbors that have them, as the only blocks that span the
+    // process boundary otherwise are rectilinear and do not use the ghost cells
+    
+    int metric_flag = (has_metric) ? 1 : 0;
+    int metricp[3], metricm[3];
+    
+    for (int i=0; i<3; i++) {
+        metricp[i] = 0;
+        metricm[i] = 0;
+    }
+    
+    for (int i=0; i<ndim; i++) {
+        MPI_Sendrecv(&metric_flag, 1, MPI_INT, shiftp_dest[i], 2*i,
+                     &metricm[i], 1, MPI_INT, shiftp_source[i], 2*i, comm, &status);
+        MPI_Sendrecv(&metric_flag, 1, MPI_INT, shiftm_dest[i], 2*i+1,
+                     &metricp[i], 1, MPI_INT, shiftm_source[i], 2*i+1, comm, &status);
+    }
+    
+    if (!has_metric) { return; }
+    
+    int metricp_proc[3], metricm_proc[3];
+    
+    for (int i=0; i<ndim; i++) {
+        metricp_proc[i] = (metricp[i] == 1) ? shiftp_dest[i] : MPI_PROC_NULL;
+        metricm_proc[i] = (metricm[i] == 1) ? shiftm_dest[i] : MPI_PROC_NULL;
+    }
+    
     // set up strided arrays for sending metric data
     
     MPI_Type_vector(ndim*ndim,c.get_xp_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-                    MPI_DOUBLE,&gridslicep[0]);
+                    MPI_GRIDREAL,&gridslicep[0]);
     MPI_Type_commit(&gridslicep[0]);
     
     MPI_Type_vector(ndim*ndim,c.get_xm_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-                    MPI_DOUBLE,&gridslicem[0]);
+                    MPI_GRIDREAL,&gridslicem[0]);
     MPI_Type_commit(&gridslicem[0]);
     
-    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0),c.get_xp_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&gridslicep[1]);
+    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0),c.get_xp_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_GRIDREAL,&gridslicep[1]);
     MPI_Type_commit(&gridslicep[1]);
     
-    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0),c.get_xm_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&gridslicem[1]);
+    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0),c.get_xm_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_GRIDREAL,&gridslicem[1]);
     MPI_Type_commit(&gridslicem[1]);
     
-    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xp_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&gridslicep[2]);
+    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xp_ghost(2),c.get_nx_tot(2),MPI_GRIDREAL,&gridslicep[2]);
     MPI_Type_commit(&gridslicep[2]);
     
-    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xm_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&gridslicem[2]);
+    MPI_Type_vector(ndim*ndim*c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xm_ghost(2),c.get_nx_tot(2),MPI_GRIDREAL,&gridslicem[2]);
     MPI_Type_commit(&gridslicem[2]);
     
     // exchange metric data
     
     for (int i=0; i<ndim; i++) {
-        MPI_Sendrecv(&metric[shiftp_source_index[i]], 1, gridslicep[i], shiftp_dest[i], 2*i,
-                     &metric[shiftp_dest_index[i]], 1, gridslicem[i], shiftp_source[i], 2*i, comm, &status);
-        MPI_Sendrecv(&metric[shiftm_source_index[i]], 1, gridslicem[i], shiftm_dest[i], 2*i+1,
-                     &metric[shiftm_dest_index[i]], 1, gridslicep[i], shiftm_source[i], 2*i+1, comm, &status);
+        MPI_Sendrecv(&metric[shiftp_source_index[i]], 1, gridslicep[i], metricp_proc[i], 2*i,
+                     &metric[shiftp_dest_index[i]], 1, gridslicem[i], metricm_proc[i], 2*i, comm, &status);
+        MPI_Sendrecv(&metric[shiftm_source_index[i]], 1, gridslicem[i], metricm_proc[i], 2*i+1,
+                     &metric[shiftm_dest_index[i]], 1, gridslicep[i], metricp_proc[i], 2*i+1, comm, &status);
     }
     
     // free strided arrays
@@ -398,32 +992,32 @@ void fields::exchange_grid() {
     // set up strided arrays for sending jacobian data
     
     MPI_Type_vector(1,c.get_xp_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-                    MPI_DOUBLE,&gridslicep[0]);
+                    MPI_GRIDREAL,&gridslicep[0]);
     MPI_Type_commit(&gridslicep[0]);
     
     MPI_Type_vector(1,c.get_xm_ghost(0)*c.get_nx_tot(1)*c.get_nx_tot(2),c.get_nx_tot(0)*c.get_nx_tot(1)*c.get_nx_tot(2),
-                    MPI_DOUBLE,&gridslicem[0]);
+                    MPI_GRIDREAL,&gridslicem[0]);
     MPI_Type_commit(&gridslicem[0]);
     
-    MPI_Type_vector(c.get_nx_tot(0),c.get_xp_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&gridslicep[1]);
+    MPI_Type_vector(c.get_nx_tot(0),c.get_xp_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_GRIDREAL,&gridslicep[1]);
     MPI_Type_commit(&gridslicep[1]);
     
-    MPI_Type_vector(c.get_nx_tot(0),c.get_xm_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_DOUBLE,&gridslicem[1]);
+    MPI_Type_vector(c.get_nx_tot(0),c.get_xm_ghost(1)*c.get_nx_tot(2),c.get_nx_tot(1)*c.get_nx_tot(2),MPI_GRIDREAL,&gridslicem[1]);
     MPI_Type_commit(&gridslicem[1]);
     
-    MPI_Type_vector(c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xp_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&gridslicep[2]);
+    MPI_Type_vector(c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xp_ghost(2),c.get_nx_tot(2),MPI_GRIDREAL,&gridslicep[2]);
     MPI_Type_commit(&gridslicep[2]);
     
-    MPI_Type_vector(c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xm_ghost(2),c.get_nx_tot(2),MPI_DOUBLE,&gridslicem[2]);
+    MPI_Type_vector(c.get_nx_tot(0)*c.get_nx_tot(1),c.get_xm_ghost(2),c.get_nx_tot(2),MPI_GRIDREAL,&gridslicem[2]);
     MPI_Type_commit(&gridslicem[2]);
     
     // exchange jacobian data
     
     for (int i=0; i<ndim; i++) {
-        MPI_Sendrecv(&jac[shiftp_source_index[i]], 1, gridslicep[i], shiftp_dest[i], 2*i,
-                     &jac[shiftp_dest_index[i]], 1, gridslicem[i], shiftp_source[i], 2*i, comm, &status);
-        MPI_Sendrecv(&jac[shiftm_source_index[i]], 1, gridslicem[i], shiftm_dest[i], 2*i+1,
-                     &jac[shiftm_dest_index[i]], 1, gridslicep[i], shiftm_source[i], 2*i+1, comm, &status);
+        MPI_Sendrecv(&jac[shiftp_source_index[i]], 1, gridslicep[i], metricp_proc[i], 2*i,
+                     &jac[shiftp_dest_index[i]], 1, gridslicem[i], metricm_proc[i], 2*i, comm, &status);
+        MPI_Sendrecv(&jac[shiftm_source_index[i]], 1, gridslicem[i], metricm_proc[i], 2*i+1,
+                     &jac[shiftm_dest_index[i]], 1, gridslicep[i], metricp_proc[i], 2*i+1, comm, &status);
     }
     
     // free strided arrays
@@ -435,17 +1029,40 @@ void fields::exchange_grid() {
     MPI_Type_free(&gridslicep[1]);
     MPI_Type_free(&gridslicep[2]);
     
+    // precomputed products of jacobian and metric, including ghost cells
+    
+    if (has_precomputed) {
+        for (int i=0; i<ndim*ndim; i++) {
+            for (int j=0; j<nxyz; j++) {
+                jmetric[i*nxyz+j] = jac[j]*metric[i*nxyz+j];
+            }
+        }
+    }
+    
 }
 
 void fields::free_exchange() {
-    // free MPI Types for ghost cell exchange
+    // free persistent requests, shared memory window, and buffers for ghost cell exchange
     
-    MPI_Type_free(&slicem[0]);
-    MPI_Type_free(&slicem[1]);
-    MPI_Type_free(&slicem[2]);
-    MPI_Type_free(&slicep[0]);
-    MPI_Type_free(&slicep[1]);
-    MPI_Type_free(&slicep[2]);
+    if (exchange == "persistent") {
+        for (int i=0; i<2*ndim; i++) {
+            MPI_Request_free(&recv_req[i]);
+            MPI_Request_free(&send_req[i]);
+        }
+    } else if (exchange == "shared") {
+        wait_shared();
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+        MPI_Comm_free(&nodecomm);
+        f = 0;
+    }
+    
+    for (int i=0; i<3; i++) {
+        delete[] sendbufp[i];
+        delete[] sendbufm[i];
+        delete[] recvbufp[i];
+        delete[] recvbufm[i];
+    }
     
 }
 
@@ -579,6 +1196,39 @@ void fields::read_load(const string loadfile) {
     
 }
 
+void fields::set_matd() {
+    // sets derived material properties from heterogeneous material data, including ghost cells
+    // stores inverse density, 2G+lambda, wave speeds cp and cs, impedances zp and zs, and 1-2(cs/cp)^2,
+    // so that the kernels, boundaries, and interfaces do not need divides or square roots per point
+    // for mode 3 problems, only inverse density, cs, and zs are set (mat holds density and shear modulus)
+    // ghost points outside the domain have zero density and are left as zero
+    
+    nmatd = 7;
+    
+    matd = new double [nmatd*nxyz];
+    
+    for (int i=0; i<nmatd*nxyz; i++) {
+        matd[i] = 0.;
+    }
+    
+    for (int i=0; i<nxyz; i++) {
+        if (mat[i] <= 0.) { continue; }
+        matd[i] = 1./mat[i];
+        if (ndim == 2 && mode == 3) {
+            matd[3*nxyz+i] = sqrt(mat[nxyz+i]/mat[i]);
+            matd[5*nxyz+i] = mat[i]*matd[3*nxyz+i];
+        } else {
+            matd[nxyz+i] = 2.*mat[2*nxyz+i]+mat[nxyz+i];
+            matd[2*nxyz+i] = sqrt((mat[nxyz+i]+2.*mat[2*nxyz+i])/mat[i]);
+            matd[3*nxyz+i] = sqrt(mat[2*nxyz+i]/mat[i]);
+            matd[4*nxyz+i] = mat[i]*matd[2*nxyz+i];
+            matd[5*nxyz+i] = mat[i]*matd[3*nxyz+i];
+            matd[6*nxyz+i] = 1.-2.*pow(matd[3*nxyz+i]/matd[2*nxyz+i],2);
+        }
+    }
+    
+}
+
 void fields::read_mat(const string matfile) {
     // read heterogeneous material data from file
     
@@ -708,5 +1358,9 @@ void fields::read_mat(const string matfile) {
     MPI_Type_free(&gridslicep[1]);
     MPI_Type_free(&gridslicep[2]);
     
+    // compute derived material properties used by the finite difference kernels and boundary conditions
+    
+    set_matd();
+    
 }
 	
@@ -4,6 +4,7 @@
 #include <string>
 #include "cartesian.hpp"
 #include "coord.hpp"
+#include "precision.hpp"
 #include <mpi.h>
 
 class fields
@@ -19,10 +20,14 @@ public:
 	~fields();
     void scale_df(const double A);
     void update(const double B);
-    void set_stress();
-    void remove_stress();
 	void exchange_neighbors();
+    void start_exchange();
+    void finish_exchange();
+    void write_exchange_info() const;
     void exchange_grid();
+    void allocate_metric();
+    void allocate_precomputed();
+    void write_memory_info() const;
     void free_exchange();
 private:
 	int ndim;
@@ -31,9 +36,15 @@ private:
     bool hetstress;
     bool hetmat;
     bool plastic_tensor;
+    double plastic_margin;
+    bool track_stress;
+    double stress_change;
+    bool has_metric;
+    bool has_precomputed;
     int nv;
     int ns;
     int nmat;
+    int nmatd;
     int nxyz;
     int index[6];
 	int nfields;
@@ -55,17 +66,51 @@ private:
     double s0[6];
     double* s;
     double* mat;
-	double* f;
+    double* matd;
+	fieldreal* f;
 	double* df;
-    double* x;
-    double* metric;
-    double* jac;
+    gridreal* x;
+    gridreal* metric;
+    gridreal* jac;
+    gridreal* jmetric;
+    gridreal* smetric;
 	MPI_Comm comm;
-	MPI_Datatype slicep[3];
-	MPI_Datatype slicem[3];
+	int nbufp[3];
+	int nbufm[3];
+	fieldreal* sendbufp[3];
+	fieldreal* sendbufm[3];
+	fieldreal* recvbufp[3];
+	fieldreal* recvbufm[3];
+	std::string exchange;
+	int halo;
+	MPI_Request recv_req[6];
+	MPI_Request send_req[6];
+	int counts[6];
+	MPI_Aint sdispls[6];
+	MPI_Aint rdispls[6];
+	MPI_Datatype types[6];
+	int nexchange;
+	double pack_time[3];
+	double unpack_time[3];
+	MPI_Comm nodecomm;
+	MPI_Win win;
+	bool nbr_shared[6];
+	fieldreal* nbr_f[6];
+	int nbr_nx[6][3];
+	int nbr_start[6];
+	MPI_Request done_req[12];
+	bool done_pending;
 	void init_exchange(const cartesian& cart);
+	void init_shared();
+	void copy_shared(const int side);
+	void wait_shared();
+    void pack(const int direction, const int start, const int width, fieldreal* buf) const;
+    void unpack(const int direction, const int start, const int width, const fieldreal* buf);
+    void start_exchange_direction(const int direction);
+    void finish_exchange_direction(const int direction);
     void read_load(const std::string loadfile);
     void read_mat(const std::string matfile);
+    void set_matd();
 };
 
 #endif
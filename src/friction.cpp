@@ -54,6 +54,25 @@ friction::friction(const char* filename, const int ndim_in, const int mode_in, c
             sn[i] = 0.;
         }
         
+        // allocate row buffers used when solving the friction law for a row of points
+        
+        fricbuf = new double [14*n_loc[1]];
+        
+        for (int i=0; i<3; i++) {
+            phirow[i] = fricbuf+i*n_loc[1];
+        }
+        
+        etarow = fricbuf+3*n_loc[1];
+        snrow = fricbuf+4*n_loc[1];
+        murow = fricbuf+5*n_loc[1];
+        crow = fricbuf+6*n_loc[1];
+        vrow = fricbuf+7*n_loc[1];
+        srow = fricbuf+8*n_loc[1];
+        
+        for (int i=0; i<5; i++) {
+            prow[i] = fricbuf+(9+i)*n_loc[1];
+        }
+        
     }
     
     // read loads from input file
@@ -170,7 +189,7 @@ friction::friction(const char* filename, const int ndim_in, const int mode_in, c
         loads = new load* [nloads];
         
         for (int i=0; i<nloads; i++) {
-            loads[i] = new load(ltype[i], t0[i], x0[i], dx[i], y0[i] , dy[i], n, xm_2d, xm_loc2d, x_2d, l_2d, sl1[i], sl2[i], sl3[i]);
+            loads[i] = new load(ltype[i], t0[i], x0[i], dx[i], y0[i] , dy[i], n, n_loc, xm_2d, xm_loc2d, x_2d, l_2d, sl1[i], sl2[i], sl3[i]);
         }
         
     }
@@ -185,6 +204,22 @@ friction::friction(const char* filename, const int ndim_in, const int mode_in, c
     delete[] sl2;
     delete[] sl3;
     
+    // allocate memory for loads
+    
+    if (!no_data) {
+        
+        s1 = new double [n_loc[0]*n_loc[1]];
+        s2 = new double [n_loc[0]*n_loc[1]];
+        s3 = new double [n_loc[0]*n_loc[1]];
+        
+        for (int i=0; i<n_loc[0]*n_loc[1]; i++) {
+            s1[i] = 0.;
+            s2[i] = 0.;
+            s3[i] = 0.;
+        }
+        
+    }
+    
     // if needed, read load data from file
     
     if (loadfile == "none") {
@@ -192,16 +227,6 @@ friction::friction(const char* filename, const int ndim_in, const int mode_in, c
     } else {
         load_file = true;
         
-        // allocate memory for loads
-        
-        if (!no_data) {
-            
-            s1 = new double [n_loc[0]*n_loc[1]];
-            s2 = new double [n_loc[0]*n_loc[1]];
-            s3 = new double [n_loc[0]*n_loc[1]];
-            
-        }
-        
         // read load for each potential side of interface (may be read twice if both sides in process)
         
         read_load(loadfile, !data1);
@@ -209,15 +234,49 @@ friction::friction(const char* filename, const int ndim_in, const int mode_in, c
         
         // if 2d problem, override unused traction components by setting to zero
         
-        if (ndim == 2 && mode == 2) {
-            for (int i=0; i<n_loc[0]*n_loc[1]; i++) {
-                s3[i] = 0.;
+        if (!no_data) {
+            if (ndim == 2 && mode == 2) {
+                for (int i=0; i<n_loc[0]*n_loc[1]; i++) {
+                    s3[i] = 0.;
+                }
+            } else if (ndim == 2 && mode == 3) {
+                for (int i=0; i<n_loc[0]*n_loc[1]; i++) {
+                    s2[i] = 0.;
+                }
             }
-        } else if (ndim == 2 && mode == 3) {
-            for (int i=0; i<n_loc[0]*n_loc[1]; i++) {
-                s2[i] = 0.;
+        }
+    }
+    
+    // add loads that do not change with time to load arrays
+    // only loads that ramp up in time are kept, and are summed with the fixed loads once per stage
+    
+    if (!no_data) {
+        
+        int ntime = 0;
+        
+        for (int k=0; k<nloads; k++) {
+            if (loads[k]->time_dependent()) {
+                loads[ntime] = loads[k];
+                ntime++;
+            } else {
+                loads[k]->add_load(0., s1, s2, s3);
+                delete loads[k];
             }
         }
+        
+        nloads = ntime;
+        
+        if (nloads > 0) {
+            loadbuf = new double [3*n_loc[0]*n_loc[1]];
+            for (int i=0; i<3; i++) {
+                sload[i] = loadbuf+i*n_loc[0]*n_loc[1];
+            }
+        } else {
+            sload[0] = s1;
+            sload[1] = s2;
+            sload[2] = s3;
+        }
+        
     }
     
 }
@@ -238,202 +297,279 @@ friction::~friction() {
     delete[] s;
     delete[] sn;
     
+    delete[] fricbuf;
+    
     for (int i=0; i<nloads; i++) {
         delete loads[i];
     }
     
     delete[] loads;
     
-    if (load_file) {
-        delete[] s1;
-        delete[] s2;
-        delete[] s3;
+    delete[] s1;
+    delete[] s2;
+    delete[] s3;
+    
+    if (nloads > 0) {
+        delete[] loadbuf;
     }
 
 }
 
-iffields friction::solve_interface(const boundfields b1, const boundfields b2, const double zp1, const double zs1, const double zp2, const double zs2, const int i, const int j, const double t) {
-    // solves boundary conditions for a frictionless interface
+void friction::calc_loads(const double t) {
+    // sums loads that ramp up in time with the fixed loads for the current stage
     
-    ifchar ifcp, ifchatp;
+    if (nloads == 0) { return; }
     
-    ifcp.v1 = b1.v1;
-    ifcp.v2 = b2.v1;
-    ifcp.s1 = b1.s11;
-    ifcp.s2 = b2.s11;
-    
-    ifchatp = solve_locked(ifcp,zp1,zp2);
-    
-    iffields iffin, iffout;
-    
-    iffin.v12 = b1.v2;
-    iffin.v22 = b2.v2;
-    iffin.v13 = b1.v3;
-    iffin.v23 = b2.v3;
-    iffin.s12 = b1.s12;
-    iffin.s22 = b2.s12;
-    iffin.s13 = b1.s13;
-    iffin.s23 = b2.s13;
-    
-    iffout = solve_friction(iffin, ifchatp.s1, zs1, zs2, i, j, t);
-    
-    iffout.v11 = ifchatp.v1;
-    iffout.v21 = ifchatp.v2;
-    iffout.s11 = ifchatp.s1;
-    iffout.s21 = ifchatp.s2;
+    for (int i=0; i<n_loc[0]*n_loc[1]; i++) {
+        sload[0][i] = s1[i];
+        sload[1][i] = s2[i];
+        sload[2][i] = s3[i];
+    }
     
-    return iffout;
+    for (int k=0; k<nloads; k++) {
+        loads[k]->add_load(t, sload[0], sload[1], sload[2]);
+    }
     
 }
 
-iffields friction::solve_friction(iffields iffin, double snc, const double z1, const double z2, const int i, const int j, const double t) {
-    // solve friction law for shear tractions and slip velocities
+void friction::solve_row(const int i, const double t) {
+    // solves boundary conditions for a frictional interface for a row of points
+    // normal tractions are found as for a locked interface, then the friction law is solved for the whole row
+    
+    const int nj = n_loc[1];
     
-    const double eta = z1*z2/(z1+z2);
-    double phi, phi2, phi3, v2, v3;
+    // loads for the row, summed once per stage
     
-    // calculate index
+    const double* lsn = sload[0]+i*nj;
+    const double* ls2 = sload[1]+i*nj;
+    const double* ls3 = sload[2]+i*nj;
     
-    int index = i*n_loc[1]+j;
+    // row buffer pointers are held in locals, as stores in the loop could otherwise change the members
     
-    // add boundary loads
+    const double* r1[6];
+    const double* r2[6];
+    const double* z[4];
+    double* h[12];
     
-    if (load_file) {
-        snc += s1[index];
-        iffin.s12 += s2[index];
-        iffin.s22 += s2[index];
-        iffin.s13 += s3[index];
-        iffin.s23 += s3[index];
+    for (int c=0; c<6; c++) {
+        r1[c] = rot1[c];
+        r2[c] = rot2[c];
     }
     
-    for (int k=0; k<nloads; k++) {
-        snc += loads[k]->get_sn(i,j,t);
-        iffin.s12 += loads[k]->get_s2(i,j,t);
-        iffin.s22 += loads[k]->get_s2(i,j,t);
-        iffin.s13 += loads[k]->get_s3(i,j,t);
-        iffin.s23 += loads[k]->get_s3(i,j,t);
+    for (int c=0; c<4; c++) {
+        z[c] = zrow[c];
     }
     
-    phi2 = eta*(iffin.s12/z1-iffin.v12+iffin.s22/z2+iffin.v22);
-    phi3 = eta*(iffin.s13/z1-iffin.v13+iffin.s23/z2+iffin.v23);
-    phi = sqrt(pow(phi2,2)+pow(phi3,2));
+    for (int c=0; c<12; c++) {
+        h[c] = hat[c];
+    }
     
-    boundchar b = solve_fs(phi, eta, snc, i, j, t);
+    double* etar = etarow;
+    double* snr = snrow;
+    double* phir = phirow[0];
+    double* phi2r = phirow[1];
+    double* phi3r = phirow[2];
     
-    iffields iffout;
+    // solve for normal characteristics and shear stress on a locked interface
     
-    if (b.v == 0.) {
+    #pragma omp simd
+    for (int j=0; j<nj; j++) {
         
-        // fault is locked
+        ifchar ifcp, ifchatp;
         
-        v2 = 0.;
-        v3 = 0.;
+        ifcp.v1 = r1[0][j];
+        ifcp.v2 = r2[0][j];
+        ifcp.s1 = r1[3][j];
+        ifcp.s2 = r2[3][j];
         
-    } else {
+        ifchatp = solve_locked(ifcp,z[0][j],z[2][j]);
         
-        // fault slips
+        h[0][j] = ifchatp.v1;
+        h[3][j] = ifchatp.s1;
+        h[6][j] = ifchatp.v2;
+        h[9][j] = ifchatp.s2;
         
-        v2 = b.v*phi2/(eta*b.v+b.s);
-        v3 = b.v*phi3/(eta*b.v+b.s);
+        const double z1 = z[1][j], z2 = z[3][j];
+        const double eta = z1*z2/(z1+z2);
+        const double phi2 = eta*((r1[4][j]+ls2[j])/z1-r1[1][j]+(r2[4][j]+ls2[j])/z2+r2[1][j]);
+        const double phi3 = eta*((r1[5][j]+ls3[j])/z1-r1[2][j]+(r2[5][j]+ls3[j])/z2+r2[2][j]);
+        
+        etar[j] = eta;
+        snr[j] = ifchatp.s1+lsn[j];
+        phir[j] = sqrt(phi2*phi2+phi3*phi3);
+        phi2r[j] = phi2;
+        phi3r[j] = phi3;
         
     }
     
-    // solve for characteristics
+    // solve friction law for slip velocity and strength
     
-    iffout.s12 = phi2-eta*v2;
-    iffout.s22 = iffout.s12;
-    iffout.s13 = phi3-eta*v3;
-    iffout.s23 = iffout.s13;
-    iffout.v12 = (iffout.s12-iffin.s12)/z1+iffin.v12;
-    iffout.v22 = (-iffout.s22+iffin.s22)/z2+iffin.v22;
-    iffout.v13 = (iffout.s13-iffin.s13)/z1+iffin.v13;
-    iffout.v23 = (-iffout.s23+iffin.s23)/z2+iffin.v23;
+    solve_fs_row(i, t);
     
-    // set interface variables to hat variables
+    // solve for characteristics and set interface variables to hat variables
+    // slip components stored depend on the problem type, so a separate loop is used for each
     
-    v[index] = b.v;
-    s[index] = b.s;
-    sn[index] = snc;
     switch (ndim) {
         case 3:
-            vx[0*n_loc[0]*n_loc[1]+index] = v2;
-            vx[1*n_loc[0]*n_loc[1]+index] = v3;
-            sx[0*n_loc[0]*n_loc[1]+index] = iffout.s12;
-            sx[1*n_loc[0]*n_loc[1]+index] = iffout.s13;
+            set_slip_row<3>(i);
             break;
         case 2:
             switch (mode) {
                 case 2:
-                    vx[index] = v2;
-                    sx[index] = iffout.s12;
+                    set_slip_row<2>(i);
                     break;
                 case 3:
-                    vx[index] = v3;
-                    sx[index] = iffout.s13;
+                    set_slip_row<1>(i);
             }
     }
     
-    // subtract boundary loads before returning field values
+}
+
+template <int kind>
+void friction::set_slip_row(const int i) {
+    // sets hat variables, slip velocity, and shear stress for a row of points once friction law is solved
+    // kind is 3 for 3D problems, 2 for mode 2, and 1 for mode 3
+    
+    const int nj = n_loc[1];
+    const int nx = n_loc[0]*nj;
+    
+    const double* ls2 = sload[1]+i*nj;
+    const double* ls3 = sload[2]+i*nj;
+    
+    // local pointers for the row, as in solve_row
     
-    if (load_file) {
-        iffout.s12 -= s2[index];
-        iffout.s22 -= s2[index];
-        iffout.s13 -= s3[index];
-        iffout.s23 -= s3[index];
+    const double* r1[6];
+    const double* r2[6];
+    double* h[12];
+    
+    for (int c=0; c<6; c++) {
+        r1[c] = rot1[c];
+        r2[c] = rot2[c];
     }
     
-    for (int k=0; k<nloads; k++) {
-        iffout.s12 -= loads[k]->get_s2(i,j,t);
-        iffout.s22 -= loads[k]->get_s2(i,j,t);
-        iffout.s13 -= loads[k]->get_s3(i,j,t);
-        iffout.s23 -= loads[k]->get_s3(i,j,t);
+    for (int c=0; c<12; c++) {
+        h[c] = hat[c];
     }
     
-    return iffout;
+    const double* z1r = zrow[1];
+    const double* z2r = zrow[3];
+    const double* etar = etarow;
+    const double* snr = snrow;
+    const double* vr = vrow;
+    const double* sr = srow;
+    const double* phi2r = phirow[1];
+    const double* phi3r = phirow[2];
+    double* vi = v+i*nj;
+    double* si = s+i*nj;
+    double* sni = sn+i*nj;
+    double* vx1 = vx+i*nj;
+    double* sx1 = sx+i*nj;
+    double* vx2 = (kind == 3) ? vx+nx+i*nj : vx1;
+    double* sx2 = (kind == 3) ? sx+nx+i*nj : sx1;
+    
+    #pragma omp simd
+    for (int j=0; j<nj; j++) {
+        
+        const double z1 = z1r[j], z2 = z2r[j], eta = etar[j];
+        const double vt = vr[j], st = sr[j];
+        
+        // slip velocity components are zero if fault is locked
+        
+        const double v2slip = vt*phi2r[j]/(eta*vt+st);
+        const double v3slip = vt*phi3r[j]/(eta*vt+st);
+        const double v2 = (vt == 0.) ? 0. : v2slip;
+        const double v3 = (vt == 0.) ? 0. : v3slip;
+        
+        const double s12 = phi2r[j]-eta*v2;
+        const double s13 = phi3r[j]-eta*v3;
+        
+        h[1][j] = (s12-(r1[4][j]+ls2[j]))/z1+r1[1][j];
+        h[2][j] = (s13-(r1[5][j]+ls3[j]))/z1+r1[2][j];
+        h[7][j] = (-s12+(r2[4][j]+ls2[j]))/z2+r2[1][j];
+        h[8][j] = (-s13+(r2[5][j]+ls3[j]))/z2+r2[2][j];
+        
+        // subtract boundary loads before setting field values
+        
+        h[4][j] = s12-ls2[j];
+        h[5][j] = s13-ls3[j];
+        h[10][j] = s12-ls2[j];
+        h[11][j] = s13-ls3[j];
+        
+        vi[j] = vt;
+        si[j] = st;
+        sni[j] = snr[j];
+        
+        if (kind == 3) {
+            vx1[j] = v2;
+            vx2[j] = v3;
+            sx1[j] = s12;
+            sx2[j] = s13;
+        } else if (kind == 2) {
+            vx1[j] = v2;
+            sx1[j] = s12;
+        } else {
+            vx1[j] = v3;
+            sx1[j] = s13;
+        }
+        
+    }
     
 }
 
-boundchar friction::solve_fs(const double phi, const double eta, const double snc, const int i, const int j, const double t) {
-    // solves friction law for slip velocity and strength
-    // each friction law supplies its own function for calc_mu
+void friction::solve_fs_row(const int i, const double t) {
+    // solves friction law for slip velocity and strength for a row of points
+    // each friction law supplies its own function for calc_mu_row
+    
+    calc_mu_row(i, t);
     
-    boundchar b;
+    // local pointers for the row, as in solve_row
     
-    if (snc < 0.) {
-        // compressive normal stress
+    const int nj = n_loc[1];
+    const double* phir = phirow[0];
+    const double* snr = snrow;
+    const double* etar = etarow;
+    const double* mur = murow;
+    const double* cr = crow;
+    double* vr = vrow;
+    double* sr = srow;
+    
+    #pragma omp simd
+    for (int j=0; j<nj; j++) {
         
-        double mu = calc_mu(phi, eta, snc, i, j, t);
+        // strength is cohesion plus friction under compressive normal stress, cohesion only in tension
         
-        if (mu*fabs(snc) > phi) {
-            // locked
-            b.v = 0.;
-            b.s = phi;
-        } else {
-            // slipping
-            b.s = mu*fabs(snc);
-            b.v = (phi-b.s)/eta;
-            
-        }
+        const double phi = phir[j], snc = snr[j];
+        const double st = cr[j]+mur[j]*((snc < 0.) ? -snc : 0.);
+
+        // locked if strength exceeds shear stress, or equals it in tension
+        // bitwise operators avoid branches so that the loop vectorizes
+
+        const bool locked = (st > phi) | (!(snc < 0.) & (st == phi));
+        
+        // strength equals shear stress where locked, so slip velocity is exactly zero there
+        
+        const double sfric = locked ? phi : st;
+        
+        sr[j] = sfric;
+        vr[j] = (phi-sfric)/etar[j];
         
-    } else {
-        // tensile normal stress, no shear strength
-        b.s = 0.;
-        b.v = phi/eta;
     }
     
     // if state variable, set time derivative using hat variables
     
     if (has_state) {
-        dstatedt[i*n_loc[1]+j] = calc_dstatedt(b.v, b.s, i, j, t);
+        calc_dstatedt_row(i, t);
     }
     
-    return b;
 }
 
-double friction::calc_mu(const double phi, const double eta, const double snc, const int i, const int j, const double t) const {
-    // calculates friction coefficient
+void friction::calc_mu_row(const int i, const double t) {
+    // calculates friction coefficient and cohesion for a row of points
     
-    return 0.;
+    for (int j=0; j<n_loc[1]; j++) {
+        murow[j] = 0.;
+        crow[j] = 0.;
+    }
     
 }
 
@@ -647,9 +783,7 @@ void friction::read_params(const string filename, const bool data_proc) {
     
 }
 
-double friction::calc_dstatedt(const double vhat, const double shat, const int i, const int j, const double t) const {
-    // calculates state variable derivative based on hat variables
-
-    return 0.;
+void friction::calc_dstatedt_row(const int i, const double t) {
+    // calculates state variable derivative based on hat variables for a row of points
 
 }
\ No newline at end of file
@@ -32,14 +32,26 @@ protected:
     double* s1;
     double* s2;
     double* s3;
+    double* loadbuf;
+    double* sload[3];
+    double* fricbuf;
+    double* phirow[3];
+    double* etarow;
+    double* snrow;
+    double* murow;
+    double* crow;
+    double* vrow;
+    double* srow;
+    double* prow[5];
     void read_load(const std::string loadfile, const bool data_proc);
     void read_state(const std::string statefile, const bool data_proc);
     virtual void read_params(const std::string paramfile, const bool data_proc);
-    virtual iffields solve_interface(const boundfields b1, const boundfields b2, const double zp1, const double zs1, const double zp2, const double zs2, const int i, const int j, const double t);
-    virtual iffields solve_friction(iffields iffin, double snc, const double z1, const double z2, const int i, const int j, const double t);
-    virtual boundchar solve_fs(const double phi, const double eta, const double snc, const int i, const int j, const double t);
-    virtual double calc_mu(const double phi, const double eta, const double snc, const int i, const int j, const double t) const;
-    virtual double calc_dstatedt(const double vhat, const double shat, const int i, const int j, const double t) const;
+    virtual void calc_loads(const double t);
+    virtual void solve_row(const int i, const double t);
+    template <int kind> void set_slip_row(const int i);
+    void solve_fs_row(const int i, const double t);
+    virtual void calc_mu_row(const int i, const double t);
+    virtual void calc_dstatedt_row(const int i, const double t);
 };
 
 #endif
\ No newline at end of file
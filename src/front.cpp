@@ -256,11 +256,18 @@ void front::write_front(const domain& d) const {
             }
         }
         
-        MPI_Type_create_indexed_block(ntot, 1, disp, MPI_DOUBLE, &xarray);
+        // grid stored in single precision is converted into a contiguous double buffer before writing
         
-        MPI_Type_commit(&xarray);
+        double* xbuf = 0;
         
-        delete[] disp;
+        if (sizeof(gridreal) != sizeof(double)) {
+            xbuf = new double [ntot];
+            MPI_Type_contiguous(ntot, MPI_DOUBLE, &xarray);
+        } else {
+            MPI_Type_create_indexed_block(ntot, 1, disp, MPI_DOUBLE, &xarray);
+        }
+        
+        MPI_Type_commit(&xarray);
         
         for (int i=0; i<ndim; i++) {
             
@@ -298,7 +305,14 @@ void front::write_front(const domain& d) const {
             
             // write data
             
-            MPI_File_write(xfile, &(d.f->x[xstart]), 1, xarray, MPI_STATUS_IGNORE);
+            if (xbuf) {
+                for (int j=0; j<ntot; j++) {
+                    xbuf[j] = (double)d.f->x[xstart+disp[j]];
+                }
+                MPI_File_write(xfile, xbuf, 1, xarray, MPI_STATUS_IGNORE);
+            } else {
+                MPI_File_write(xfile, &(d.f->x[xstart]), 1, xarray, MPI_STATUS_IGNORE);
+            }
             
             // close file
             
@@ -311,6 +325,12 @@ void front::write_front(const domain& d) const {
         MPI_Type_free(&filearray);
         MPI_Type_free(&xarray);
         
+        delete[] disp;
+        
+        if (xbuf) {
+            delete[] xbuf;
+        }
+        
     }
     
     // if master, open files for matlab and python
@@ -391,14 +391,20 @@ interface::interface(const char* filename, const int ndim_in, const int mode_in,
     
     // allocate memory for arrays for normal vectors and grid spacing
     
-    double dx1[3], dx2[3];
+    double dx1[3], dx2[3], rmetric1[3], rmetric2[3];
     
     for (int i=0; i<3; i++) {
         dx1[i] = b1->get_dx(i);
         dx2[i] = b2->get_dx(i);
+        rmetric1[i] = b1->get_rmetric(i);
+        rmetric2[i] = b2->get_rmetric(i);
     }
     
-    allocate_normals(dx1,dx2,f,fd);
+    allocate_normals(dx1,dx2,b1->get_rectilinear(),b2->get_rectilinear(),rmetric1,rmetric2,f,fd);
+    
+    // select row functions for this problem type
+    
+    set_row_kernel(f);
 
 }
 
@@ -411,167 +417,183 @@ interface::~interface() {
     
 }
 
-void interface::allocate_normals(const double dx1[3], const double dx2[3], const fields& f, const fd_type& fd) {
-    // allocate memory and assign normal vectors and grid spacing
+void interface::allocate_normals(const double dx1[3], const double dx2[3], const bool rect1, const bool rect2,
+                                 const double rmetric1[3], const double rmetric2[3], const fields& f, const fd_type& fd) {
+    // allocate memory and assign normal and tangent vectors and grid spacing
+    // interface points are numbered with the first index along the interface varying slowest, and the frame
+    // (normal vector, first tangent vector, second tangent vector) is stored as 9 contiguous arrays over all points
     
-    nx = new double** [ndim];
+    // index of first interface point on the side of block 1, strides along the interface, and offset to block 2
     
-    for (int i=0; i<ndim; i++) {
-        nx[i] = new double* [n_loc[0]];
-    }
+    ibase = mlb[0]*nxd[1]+mlb[1]*nxd[2]+mlb[2];
     
-    for (int i=0; i<ndim; i++) {
-        for (int j=0; j<n_loc[0]; j++) {
-            nx[i][j] = new double [n_loc[1]];
-        }
+    switch (direction) {
+        case 0:
+            istride[0] = nxd[2];
+            istride[1] = 1;
+            break;
+        case 1:
+            istride[0] = nxd[1];
+            istride[1] = 1;
+            break;
+        case 2:
+            istride[0] = nxd[1];
+            istride[1] = nxd[2];
     }
     
+    idelta = delta[0]*nxd[1]+delta[1]*nxd[2]+delta[2];
+    
+    npts = n_loc[0]*n_loc[1];
+    
+    frame = new double [9*npts];
+    
     // allocate memory for grid spacing if necessary
     
     if (data1) {
-        dl1 = new double* [n_loc[0]];
-    
-        for (int i=0; i<n_loc[0]; i++) {
-            dl1[i] = new double [n_loc[1]];
-        }
+        dl1 = new double [npts];
     }
     
     if (data2) {
-        dl2 = new double* [n_loc[0]];
-
-        for (int i=0; i<n_loc[0]; i++) {
-            dl2[i] = new double [n_loc[1]];
-        }
+        dl2 = new double [npts];
+    }
+    
+    // allocate buffers for one row of points, holding rotated fields on each side, impedances, and targets
+    // rotated fields are in the order of boundfields, impedances are zp1, zs1, zp2, zs2, and targets are in
+    // the order v11, v12, v13, s11, s12, s13, v21, v22, v23, s21, s22, s23
+    
+    rowbuf = new double [34*n_loc[1]];
+    
+    for (int i=0; i<9; i++) {
+        rot1[i] = rowbuf+i*n_loc[1];
+        rot2[i] = rowbuf+(9+i)*n_loc[1];
+    }
+    
+    for (int i=0; i<4; i++) {
+        zrow[i] = rowbuf+(18+i)*n_loc[1];
+    }
+    
+    for (int i=0; i<12; i++) {
+        hat[i] = rowbuf+(22+i)*n_loc[1];
     }
 	
-    // set grid spacings and compute normal vectors
+    // set grid spacings and compute normal vectors, using block 1 for the normal if it has data
     
     for (int i=0; i<n_loc[0]; i++) {
         for (int j=0; j<n_loc[1]; j++) {
+            const int p = i*n_loc[1]+j;
+            const int index1 = ibase+i*istride[0]+j*istride[1];
+            const int index2 = index1+idelta;
+            double nn[3] = {0., 0., 0.}, t1[3], t2[3];
             if (data1) {
-                dl1[i][j] = 0.;
-                if (direction == 0) {
-                    for (int k=0; k<ndim; k++) {
-                        dl1[i][j] += pow(f.metric[0*ndim*nxd[0]+k*nxd[0]+mlb[0]*nxd[1]+(i+mlb[1])*nxd[2]+j+mlb[2]],2);
-                        nx[k][i][j] = f.metric[0*ndim*nxd[0]+k*nxd[0]+mlb[0]*nxd[1]+(i+mlb[1])*nxd[2]+j+mlb[2]];
-                    }
-                    dl1[i][j] = sqrt(dl1[i][j]);
-                    for (int k=0; k<ndim; k++) {
-                        nx[k][i][j] /= dl1[i][j];
-                    }
-                    dl1[i][j] /= fd.get_h0()*dx1[0];
-                } else if (direction == 1) {
-                    for (int k=0; k<ndim; k++) {
-                        dl1[i][j] += pow(f.metric[1*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(mlb[1])*nxd[2]+j+mlb[2]],2);
-                        nx[k][i][j] = f.metric[1*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(mlb[1])*nxd[2]+j+mlb[2]];
-                    }
-                    dl1[i][j] = sqrt(dl1[i][j]);
-                    for (int k=0; k<ndim; k++) {
-                        nx[k][i][j] /= dl1[i][j];
-                    }
-                    dl1[i][j] /= fd.get_h0()*dx1[1];
-                } else { // direction == 2
+                if (rect1) {
+                    // rectilinear block, normal is a coordinate direction and metric is not stored
+                    nn[direction] = 1.;
+                    dl1[p] = rmetric1[direction]/(fd.get_h0()*dx1[direction]);
+                } else {
+                    dl1[p] = 0.;
                     for (int k=0; k<ndim; k++) {
-                        dl1[i][j] += pow(f.metric[2*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(j+mlb[1])*nxd[2]+mlb[2]],2);
-                        nx[k][i][j] = f.metric[2*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(j+mlb[1])*nxd[2]+mlb[2]];
+                        nn[k] = f.metric[direction*ndim*nxd[0]+k*nxd[0]+index1];
+                        dl1[p] += pow(nn[k],2);
                     }
-                    dl1[i][j] = sqrt(dl1[i][j]);
+                    dl1[p] = sqrt(dl1[p]);
                     for (int k=0; k<ndim; k++) {
-                        nx[k][i][j] /= dl1[i][j];
+                        nn[k] /= dl1[p];
                     }
-                    dl1[i][j] /= fd.get_h0()*dx1[2];
+                    dl1[p] /= fd.get_h0()*dx1[direction];
                 }
             }
             if (data2) {
-                dl2[i][j] = 0.;
-                if (direction == 0) {
-                    for (int k=0; k<ndim; k++) {
-                        dl2[i][j] += pow(f.metric[0*ndim*nxd[0]+k*nxd[0]+(mlb[0]+1)*nxd[1]+(i+mlb[1])*nxd[2]+j+mlb[2]],2);
-                        if (!data1) {
-                            nx[k][i][j] = f.metric[0*ndim*nxd[0]+k*nxd[0]+(mlb[0]+1)*nxd[1]+(i+mlb[1])*nxd[2]+j+mlb[2]];
-                        }
-                    }
-                    dl2[i][j] = sqrt(dl2[i][j]);
-                    if (!data1) {
-                        for (int k=0; k<ndim; k++) {
-                            nx[k][i][j] /= dl2[i][j];
-                        }
-                    }
-                    dl2[i][j] /= fd.get_h0()*dx2[0];
-                } else if (direction == 1) {
-                    for (int k=0; k<ndim; k++) {
-                        dl2[i][j] += pow(f.metric[1*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(mlb[1]+1)*nxd[2]+j+mlb[2]],2);
-                        if (!data1) {
-                            nx[k][i][j] = f.metric[1*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(mlb[1]+1)*nxd[2]+j+mlb[2]];
-                        }
-                    }
-                    dl2[i][j] = sqrt(dl2[i][j]);
+                if (rect2) {
                     if (!data1) {
-                        for (int k=0; k<ndim; k++) {
-                            nx[k][i][j] /= dl2[i][j];
-                        }
+                        nn[direction] = 1.;
                     }
-                    dl2[i][j] /= fd.get_h0()*dx2[1];
-                } else { // direction == 2
+                    dl2[p] = rmetric2[direction]/(fd.get_h0()*dx2[direction]);
+                } else {
+                    dl2[p] = 0.;
                     for (int k=0; k<ndim; k++) {
-                        dl2[i][j] += pow(f.metric[2*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(j+mlb[1])*nxd[2]+mlb[2]+1],2);
+                        dl2[p] += pow(f.metric[direction*ndim*nxd[0]+k*nxd[0]+index2],2);
                         if (!data1) {
-                            nx[k][i][j] = f.metric[2*ndim*nxd[0]+k*nxd[0]+(i+mlb[0])*nxd[1]+(j+mlb[1])*nxd[2]+mlb[2]+1];
+                            nn[k] = f.metric[direction*ndim*nxd[0]+k*nxd[0]+index2];
                         }
                     }
-                    dl2[i][j] = sqrt(dl2[i][j]);
+                    dl2[p] = sqrt(dl2[p]);
                     if (!data1) {
                         for (int k=0; k<ndim; k++) {
-                            nx[k][i][j] /= dl2[i][j];
+                            nn[k] /= dl2[p];
                         }
                     }
-                    dl2[i][j] /= fd.get_h0()*dx2[2];
+                    dl2[p] /= fd.get_h0()*dx2[direction];
                 }
             }
+            
+            // construct tangent vectors, with the first tangent vector having no component along one coordinate direction
+            
+            double nt;
+            
+            switch (direction) {
+                case 0:
+                    nt = sqrt(pow(nn[0],2)+pow(nn[1],2));
+                    t1[2] = 0.;
+                    t1[1] = nn[0]/nt;
+                    t1[0] = -nn[1]/nt;
+                    break;
+                case 1:
+                    nt = sqrt(pow(nn[0],2)+pow(nn[1],2));
+                    t1[2] = 0.;
+                    t1[0] = nn[1]/nt;
+                    t1[1] = -nn[0]/nt;
+                    break;
+                case 2:
+                    nt = sqrt(pow(nn[0],2)+pow(nn[2],2));
+                    t1[1] = 0.;
+                    t1[0] = nn[2]/nt;
+                    t1[2] = -nn[0]/nt;
+                    break;
+                default:
+                    assert(false);
+            }
+            
+            t2[0] = nn[1]*t1[2]-nn[2]*t1[1];
+            t2[1] = nn[2]*t1[0]-nn[0]*t1[2];
+            t2[2] = nn[0]*t1[1]-nn[1]*t1[0];
+            
+            if (direction == 1) {
+                for (int k=0; k<3; k++) {
+                    t2[k] = -t2[k];
+                }
+            }
+            
+            for (int k=0; k<3; k++) {
+                frame[k*npts+p] = nn[k];
+                frame[(3+k)*npts+p] = t1[k];
+                frame[(6+k)*npts+p] = t2[k];
+            }
         }
     }
     
 }
 
 void interface::deallocate_normals() {
-    // deallocate memory for pointers to normal vectors and grid spacings
+    // deallocate memory for normal and tangent vectors and grid spacings
     
-    for (int i=0; i<ndim; i++) {
-        for (int j=0; j<n_loc[0]; j++) {
-            delete[] nx[i][j];
-        }
-    }
-    
-    for (int i=0; i<ndim; i++) {
-        delete[] nx[i];
-    }
-    
-    delete[] nx;
+    delete[] frame;
+    delete[] rowbuf;
     
     if (data1) {
-    
-        for (int i=0; i<n_loc[0]; i++) {
-            delete[] dl1[i];
-        }
-    
         delete[] dl1;
-
     }
     
     if (data2) {
-        
-        for (int i=0; i<n_loc[0]; i++) {
-            delete[] dl2[i];
-        }
-        
         delete[] dl2;
-        
     }
     
 }
 
 void interface::apply_bcs(const double dt, const double t, fields& f, const bool no_sat) {
     // applies interface conditions
+    // points are processed one row (fixed first index along the interface) at a time in three passes: fields are
+    // loaded and rotated into the normal/tangent frame, the interface conditions are solved for the whole row, and
+    // the differences from the target values are rotated back and added as SAT terms
     
     // only proceed if boundary local to this process
     
@@ -580,451 +602,404 @@ void interface::apply_bcs(const double dt, const double t, fields& f, const bool
     // if not updating, no need to solve
     
     if ((!is_friction) && (no_sat)) { return; }
+    
+    // set any time dependent loads for this stage
+    
+    calc_loads(t);
+    
+    for (int i=0; i<n_loc[0]; i++) {
+        
+        (this->*load_row_kernel)(i, f);
+        
+        // find targets for characteristics
+        
+        solve_row(i, t);
+        
+        // if not updating, skip remainder of loop
+        
+        if (no_sat) { continue; }
+        
+        (this->*apply_row_kernel)(i, dt, f);
+        
+    }
+    
+}
 
-    int ii, jj, index1, index2;
-    double nn[3] = {0., 0., 0.}, t1[3], t2[3], h1, h2;
-    
-    for (int i=mlb[0]; i<prb[0]; i++) {
-        for (int j=mlb[1]; j<prb[1]; j++) {
-            for (int k=mlb[2]; k<prb[2]; k++) {
-                
-                // calculate index
-                
-                index1 = i*nxd[1]+j*nxd[2]+k;
-                index2 = (i+delta[0])*nxd[1]+(j+delta[1])*nxd[2]+k+delta[2];
-                
-                // find max dimension of normal vector for constructing tangent vectors
-                
-                switch (direction) {
-                    case 0:
-                        ii = j-mlb[1];
-                        jj = k-mlb[2];
-                        break;
-                    case 1:
-                        ii = i-mlb[0];
-                        jj = k-mlb[2];
-                        break;
-                    case 2:
-                        ii = i-mlb[0];
-                        jj = j-mlb[1];
-                }
+void interface::set_row_kernel(const fields& f) {
+    // selects the specialized versions of the row functions for this interface
+    // problem type, material and stress heterogeneity, and plasticity are resolved at compile time
+    // so that loops over a row have no branches
+    
+    switch (ndim) {
+        case 3:
+            set_row_kernel_kind<3>(f);
+            break;
+        case 2:
+            switch (mode) {
+                case 2:
+                    set_row_kernel_kind<2>(f);
+                    break;
+                case 3:
+                    set_row_kernel_kind<1>(f);
+            }
+    }
+    
+}
 
-                if (data1) {
-                    h1 = dt*dl1[ii][jj];
-                    if (f.hetmat) {
-                        if (ndim == 2 && mode == 3) {
-                            cs1 = sqrt(f.mat[nxd[0]+index1]/f.mat[index1]);
-                            zs1 = f.mat[index1]*cs1;
-                        } else {
-                            cp1 = sqrt((f.mat[nxd[0]+index1]+2.*f.mat[2*nxd[0]+index1])/f.mat[index1]);
-                            cs1 = sqrt(f.mat[2*nxd[0]+index1]/f.mat[index1]);
-                            zp1 = f.mat[index1]*cp1;
-                            zs1 = f.mat[index1]*cs1;
-                            gamma1 = 1.-2.*pow(cs1/cp1,2);
-                        }
-                    }
-                }
-                if (data2) {
-                    h2 = dt*dl2[ii][jj];
-                    if (f.hetmat) {
-                        if (ndim == 2 && mode == 3) {
-                            cs2 = sqrt(f.mat[nxd[0]+index2]/f.mat[index2]);
-                            zs2 = f.mat[index2]*cs2;
-                        } else {
-                            cp2 = sqrt((f.mat[nxd[0]+index2]+2.*f.mat[2*nxd[0]+index2])/f.mat[index2]);
-                            cs2 = sqrt(f.mat[2*nxd[0]+index2]/f.mat[index2]);
-                            zp2 = f.mat[index2]*cp2;
-                            zs2 = f.mat[index2]*cs2;
-                            gamma2 = 1.-2.*pow(cs2/cp2,2);
-                        }
-                    }
-                }
-				
-                for (int l=0; l<ndim; l++) {
-                    nn[l] = nx[l][ii][jj];
-                }
+template <int kind>
+void interface::set_row_kernel_kind(const fields& f) {
+    // selects row functions based on material and stress heterogeneity and plasticity
+    
+    if (f.hetstress) {
+        load_row_kernel = &interface::load_row<kind,true>;
+    } else {
+        load_row_kernel = &interface::load_row<kind,false>;
+    }
+    
+    // out of plane normal stress is only updated for mode 2 plastic problems
+    
+    if (f.hetmat) {
+        if (kind == 2 && is_plastic) {
+            apply_row_kernel = &interface::apply_row<kind,true,true>;
+        } else {
+            apply_row_kernel = &interface::apply_row<kind,true,false>;
+        }
+    } else {
+        if (kind == 2 && is_plastic) {
+            apply_row_kernel = &interface::apply_row<kind,false,true>;
+        } else {
+            apply_row_kernel = &interface::apply_row<kind,false,false>;
+        }
+    }
+    
+}
 
-                switch (direction) {
-                    case 0:
-                    	t1[2] = 0.;
-                    	t1[1] = nn[0]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                    	t1[0] = -nn[1]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                        break;
-                    case 1:
-                    	t1[2] = 0.;
-                    	t1[0] = nn[1]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                    	t1[1] = -nn[0]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                        break;
-                    case 2:
-                    	t1[1] = 0.;
-                    	t1[0] = nn[2]/sqrt(pow(nn[0],2)+pow(nn[2],2));
-                    	t1[2] = -nn[0]/sqrt(pow(nn[0],2)+pow(nn[2],2));
-                }
+template <int kind, bool hs>
+inline boundfields interface::load_fields(const fields& f, const int index) const {
+    // returns absolute fields at a grid point in xyz coordinates, with components not in the problem set to zero
+    // kind is 3 for 3D problems, 2 for mode 2, and 1 for mode 3
+    
+    const int n0 = nxd[0];
+    const fieldreal* fv = f.f;
+    const double* sh = f.s;
+    
+    boundfields b;
+    
+    if (kind == 3) {
+        b.v1 = fv[0*n0+index];
+        b.v2 = fv[1*n0+index];
+        b.v3 = fv[2*n0+index];
+        b.s11 = fv[3*n0+index]+f.s0[0]+(hs ? sh[0*n0+index] : 0.);
+        b.s12 = fv[4*n0+index]+f.s0[1]+(hs ? sh[1*n0+index] : 0.);
+        b.s13 = fv[5*n0+index]+f.s0[2]+(hs ? sh[2*n0+index] : 0.);
+        b.s22 = fv[6*n0+index]+f.s0[3]+(hs ? sh[3*n0+index] : 0.);
+        b.s23 = fv[7*n0+index]+f.s0[4]+(hs ? sh[4*n0+index] : 0.);
+        b.s33 = fv[8*n0+index]+f.s0[5]+(hs ? sh[5*n0+index] : 0.);
+    } else if (kind == 2) {
+        b.v1 = fv[0*n0+index];
+        b.v2 = fv[1*n0+index];
+        b.v3 = 0.;
+        b.s11 = fv[2*n0+index]+f.s0[0]+(hs ? sh[0*n0+index] : 0.);
+        b.s12 = fv[3*n0+index]+f.s0[1]+(hs ? sh[1*n0+index] : 0.);
+        b.s13 = 0.;
+        b.s22 = fv[4*n0+index]+f.s0[3]+(hs ? sh[2*n0+index] : 0.);
+        b.s23 = 0.;
+        b.s33 = 0.;
+    } else {
+        b.v1 = 0.;
+        b.v2 = 0.;
+        b.v3 = fv[0*n0+index];
+        b.s11 = f.s0[0];
+        b.s12 = 0.;
+        b.s13 = fv[1*n0+index]+f.s0[2]+(hs ? sh[0*n0+index] : 0.);
+        b.s22 = f.s0[3];
+        b.s23 = fv[2*n0+index]+f.s0[4]+(hs ? sh[1*n0+index] : 0.);
+        b.s33 = 0.;
+    }
+    
+    return b;
+    
+}
 
-/*                if (fabs(nn[0]) > fabs(nn[1]) && fabs(nn[0]) > fabs(nn[2])) {
-                    t1[2] = 0.;
-                    t1[1] = nn[0]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                    t1[0] = -nn[1]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                } else if (fabs(nn[1]) > fabs(nn[2])) {
-                    t1[2] = 0.;
-                    t1[0] = nn[1]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                    t1[1] = -nn[0]/sqrt(pow(nn[0],2)+pow(nn[1],2));
-                } else {
-                    t1[1] = 0.;
-                    t1[0] = nn[2]/sqrt(pow(nn[0],2)+pow(nn[2],2));
-                    t1[2] = -nn[0]/sqrt(pow(nn[0],2)+pow(nn[2],2));
-                }*/
-                t2[0] = nn[1]*t1[2]-nn[2]*t1[1];
-                t2[1] = nn[2]*t1[0]-nn[0]*t1[2];
-                t2[2] = nn[0]*t1[1]-nn[1]*t1[0];
-                
-                switch (direction) {
-                    case 1:
-                    	t2[0] = -t2[0];
-                    	t2[1] = -t2[1];
-                    	t2[2] = -t2[2];
-				}
-				
-                // rotate fields
-                
-                boundfields b1, b2, b_rot1, b_rot2, b_rots1, b_rots2;
-                
-                switch (ndim) {
-                    case 3:
-                        b1.v1 = f.f[0*nxd[0]+index1];
-                        b1.v2 = f.f[1*nxd[0]+index1];
-                        b1.v3 = f.f[2*nxd[0]+index1];
-                        b1.s11 = f.f[3*nxd[0]+index1]+f.s0[0];
-                        b1.s12 = f.f[4*nxd[0]+index1]+f.s0[1];
-                        b1.s13 = f.f[5*nxd[0]+index1]+f.s0[2];
-                        b1.s22 = f.f[6*nxd[0]+index1]+f.s0[3];
-                        b1.s23 = f.f[7*nxd[0]+index1]+f.s0[4];
-                        b1.s33 = f.f[8*nxd[0]+index1]+f.s0[5];
-                        b2.v1 = f.f[0*nxd[0]+index2];
-                        b2.v2 = f.f[1*nxd[0]+index2];
-                        b2.v3 = f.f[2*nxd[0]+index2];
-                        b2.s11 = f.f[3*nxd[0]+index2]+f.s0[0];
-                        b2.s12 = f.f[4*nxd[0]+index2]+f.s0[1];
-                        b2.s13 = f.f[5*nxd[0]+index2]+f.s0[2];
-                        b2.s22 = f.f[6*nxd[0]+index2]+f.s0[3];
-                        b2.s23 = f.f[7*nxd[0]+index2]+f.s0[4];
-                        b2.s33 = f.f[8*nxd[0]+index2]+f.s0[5];
-                        if (f.hetstress) {
-                            b1.s11 += f.s[0*nxd[0]+index1];
-                            b1.s12 += f.s[1*nxd[0]+index1];
-                            b1.s13 += f.s[2*nxd[0]+index1];
-                            b1.s22 += f.s[3*nxd[0]+index1];
-                            b1.s23 += f.s[4*nxd[0]+index1];
-                            b1.s33 += f.s[5*nxd[0]+index1];
-                            b2.s11 += f.s[0*nxd[0]+index2];
-                            b2.s12 += f.s[1*nxd[0]+index2];
-                            b2.s13 += f.s[2*nxd[0]+index2];
-                            b2.s22 += f.s[3*nxd[0]+index2];
-                            b2.s23 += f.s[4*nxd[0]+index2];
-                            b2.s33 += f.s[5*nxd[0]+index2];
-                        }
-                        break;
-                    case 2:
-                        switch (mode) {
-                            case 2:
-                                b1.v1 = f.f[0*nxd[0]+index1];
-                                b1.v2 = f.f[1*nxd[0]+index1];
-                                b1.v3 = 0.;
-                                b1.s11 = f.f[2*nxd[0]+index1]+f.s0[0];
-                                b1.s12 = f.f[3*nxd[0]+index1]+f.s0[1];
-                                b1.s13 = 0.;
-                                b1.s22 = f.f[4*nxd[0]+index1]+f.s0[3];
-                                b1.s23 = 0.;
-                                b1.s33 = 0.;
-                                b2.v1 = f.f[0*nxd[0]+index2];
-                                b2.v2 = f.f[1*nxd[0]+index2];
-                                b2.v3 = 0.;
-                                b2.s11 = f.f[2*nxd[0]+index2]+f.s0[0];
-                                b2.s12 = f.f[3*nxd[0]+index2]+f.s0[1];
-                                b2.s13 = 0.;
-                                b2.s22 = f.f[4*nxd[0]+index2]+f.s0[3];
-                                b2.s23 = 0.;
-                                b2.s33 = 0.;
-                                if (f.hetstress) {
-                                    b1.s11 += f.s[0*nxd[0]+index1];
-                                    b1.s12 += f.s[1*nxd[0]+index1];
-                                    b1.s22 += f.s[2*nxd[0]+index1];
-                                    b2.s11 += f.s[0*nxd[0]+index2];
-                                    b2.s12 += f.s[1*nxd[0]+index2];
-                                    b2.s22 += f.s[2*nxd[0]+index2];
-                                }
-                                break;
-                            case 3:
-                                b1.v1 = 0.;
-                                b1.v2 = 0.;
-                                b1.v3 = f.f[0*nxd[0]+index1];
-                                b1.s11 = f.s0[0];
-                                b1.s12 = 0.;
-                                b1.s13 = f.f[1*nxd[0]+index1]+f.s0[2];
-                                b1.s22 = f.s0[3];
-                                b1.s23 = f.f[2*nxd[0]+index1]+f.s0[4];
-                                b1.s33 = 0.;
-                                b2.v1 = 0.;
-                                b2.v2 = 0.;
-                                b2.v3 = f.f[0*nxd[0]+index2];
-                                b2.s11 = f.s0[0];
-                                b2.s12 = 0.;
-                                b2.s13 = f.f[1*nxd[0]+index2]+f.s0[2];
-                                b2.s22 = f.s0[3];
-                                b2.s23 = f.f[2*nxd[0]+index2]+f.s0[4];
-                                b2.s33 = 0.;
-                                if (f.hetstress) {
-                                    b1.s13 += f.s[0*nxd[0]+index1];
-                                    b1.s23 += f.s[1*nxd[0]+index1];
-                                    b2.s13 += f.s[0*nxd[0]+index2];
-                                    b2.s23 += f.s[1*nxd[0]+index2];
-                                }
-                        }
-                }
-                
-                b_rot1 = rotate_xy_nt(b1,nn,t1,t2);
-                b_rot2 = rotate_xy_nt(b2,nn,t1,t2);
-                
-                // save rotated fields in b_rots1, b_rots2 for s waves
-                
-                b_rots1 = b_rot1;
-                b_rots2 = b_rot2;
-                
-                // find targets for characteristics
-                
-                iffields iffhat;
-                
-                iffhat = solve_interface(b_rot1, b_rot2, zp1, zs1, zp2, zs2, ii, jj, t);
-                
-                // if not updating, skip remainder of loop
-                
-                if (no_sat) { continue; }
-                
-                // rotate normal targets back to xyz
-                
-                b_rot1.v1 -= iffhat.v11;
-                b_rot1.v2 = 0.;
-                b_rot1.v3 = 0.;
-                b_rot1.s22 = gamma1*(b_rot1.s11-iffhat.s11);
-                b_rot1.s33 = gamma1*(b_rot1.s11-iffhat.s11);
-                b_rot1.s11 -= iffhat.s11;
-                b_rot1.s12 = 0.;
-                b_rot1.s13 = 0.;
-                b_rot1.s23 = 0.;
-                b_rot2.v1 -= iffhat.v21;
-                b_rot2.v2 = 0.;
-                b_rot2.v3 = 0.;
-                b_rot2.s22 = gamma2*(b_rot2.s11-iffhat.s21);
-                b_rot2.s33 = gamma2*(b_rot2.s11-iffhat.s21);
-                b_rot2.s11 -= iffhat.s21;
-                b_rot2.s12 = 0.;
-                b_rot2.s13 = 0.;
-                b_rot2.s23 = 0.;
-                
-                b1 = rotate_nt_xy(b_rot1,nn,t1,t2);
-                b2 = rotate_nt_xy(b_rot2,nn,t1,t2);
-                
-                // add SAT term for normal characteristics
-                
-                switch (ndim) {
-                    case 3:
-                        if (data1) {
-                            f.df[0*nxd[0]+index1] -= cp1*h1*b1.v1;
-                            f.df[1*nxd[0]+index1] -= cp1*h1*b1.v2;
-                            f.df[2*nxd[0]+index1] -= cp1*h1*b1.v3;
-                            f.df[3*nxd[0]+index1] -= cp1*h1*b1.s11;
-                            f.df[4*nxd[0]+index1] -= cp1*h1*b1.s12;
-                            f.df[5*nxd[0]+index1] -= cp1*h1*b1.s13;
-                            f.df[6*nxd[0]+index1] -= cp1*h1*b1.s22;
-                            f.df[7*nxd[0]+index1] -= cp1*h1*b1.s23;
-                            f.df[8*nxd[0]+index1] -= cp1*h1*b1.s33;
-                        }
-                        if (data2) {
-                            f.df[0*nxd[0]+index2] -= cp2*h2*b2.v1;
-                            f.df[1*nxd[0]+index2] -= cp2*h2*b2.v2;
-                            f.df[2*nxd[0]+index2] -= cp2*h2*b2.v3;
-                            f.df[3*nxd[0]+index2] -= cp2*h2*b2.s11;
-                            f.df[4*nxd[0]+index2] -= cp2*h2*b2.s12;
-                            f.df[5*nxd[0]+index2] -= cp2*h2*b2.s13;
-                            f.df[6*nxd[0]+index2] -= cp2*h2*b2.s22;
-                            f.df[7*nxd[0]+index2] -= cp2*h2*b2.s23;
-                            f.df[8*nxd[0]+index2] -= cp2*h2*b2.s33;
-                        }
-                        break;
-                    case 2:
-                        switch (mode) {
-                            case 2:
-                                if (data1) {
-                                    f.df[0*nxd[0]+index1] -= cp1*h1*b1.v1;
-                                    f.df[1*nxd[0]+index1] -= cp1*h1*b1.v2;
-                                    f.df[2*nxd[0]+index1] -= cp1*h1*b1.s11;
-                                    f.df[3*nxd[0]+index1] -= cp1*h1*b1.s12;
-                                    f.df[4*nxd[0]+index1] -= cp1*h1*b1.s22;
-                                    if (is_plastic) {
-                                        f.df[5*nxd[0]+index1] -= cp1*h1*b1.s33;
-                                    }
-                                }
-                                if (data2) {
-                                    f.df[0*nxd[0]+index2] -= cp2*h2*b2.v1;
-                                    f.df[1*nxd[0]+index2] -= cp2*h2*b2.v2;
-                                    f.df[2*nxd[0]+index2] -= cp2*h2*b2.s11;
-                                    f.df[3*nxd[0]+index2] -= cp2*h2*b2.s12;
-                                    f.df[4*nxd[0]+index2] -= cp2*h2*b2.s22;
-                                    if (is_plastic) {
-                                        f.df[5*nxd[0]+index2] -= cp2*h2*b2.s33;
-                                    }
-                                }
-                        }
-                }
-                
-                // rotate tangential characteristics back to xyz
-                
-                b_rots1.v1 = 0.;
-                b_rots1.v2 -= iffhat.v12;
-                b_rots1.v3 -= iffhat.v13;
-                b_rots1.s11 = 0.;
-                b_rots1.s12 -= iffhat.s12;
-                b_rots1.s13 -= iffhat.s13;
-                b_rots1.s22 = 0.;
-                b_rots1.s23 = 0.;
-                b_rots1.s33 = 0.;
-                b_rots2.v1 = 0.;
-                b_rots2.v2 -= iffhat.v22;
-                b_rots2.v3 -= iffhat.v23;
-                b_rots2.s11 = 0.;
-                b_rots2.s12 -= iffhat.s22;
-                b_rots2.s13 -= iffhat.s23;
-                b_rots2.s22 = 0.;
-                b_rots2.s23 = 0.;
-                b_rots2.s33 = 0.;
-                
-                b1 = rotate_nt_xy(b_rots1,nn,t1,t2);
-                b2 = rotate_nt_xy(b_rots2,nn,t1,t2);
-                
-                // add SAT term for tangential characteristics
-                
-                switch (ndim) {
-                    case 3:
-                        if (data1) {
-                            f.df[0*nxd[0]+index1] -= cs1*h1*b1.v1;
-                            f.df[1*nxd[0]+index1] -= cs1*h1*b1.v2;
-                            f.df[2*nxd[0]+index1] -= cs1*h1*b1.v3;
-                            f.df[3*nxd[0]+index1] -= cs1*h1*b1.s11;
-                            f.df[4*nxd[0]+index1] -= cs1*h1*b1.s12;
-                            f.df[5*nxd[0]+index1] -= cs1*h1*b1.s13;
-                            f.df[6*nxd[0]+index1] -= cs1*h1*b1.s22;
-                            f.df[7*nxd[0]+index1] -= cs1*h1*b1.s23;
-                            f.df[8*nxd[0]+index1] -= cs1*h1*b1.s33;
-                        }
-                        if (data2) {
-                            f.df[0*nxd[0]+index2] -= cs2*h2*b2.v1;
-                            f.df[1*nxd[0]+index2] -= cs2*h2*b2.v2;
-                            f.df[2*nxd[0]+index2] -= cs2*h2*b2.v3;
-                            f.df[3*nxd[0]+index2] -= cs2*h2*b2.s11;
-                            f.df[4*nxd[0]+index2] -= cs2*h2*b2.s12;
-                            f.df[5*nxd[0]+index2] -= cs2*h2*b2.s13;
-                            f.df[6*nxd[0]+index2] -= cs2*h2*b2.s22;
-                            f.df[7*nxd[0]+index2] -= cs2*h2*b2.s23;
-                            f.df[8*nxd[0]+index2] -= cs2*h2*b2.s33;
-                        }
-                        break;
-                    case 2:
-                        switch (mode) {
-                            case 2:
-                                if (data1) {
-                                    f.df[0*nxd[0]+index1] -= cs1*h1*b1.v1;
-                                    f.df[1*nxd[0]+index1] -= cs1*h1*b1.v2;
-                                    f.df[2*nxd[0]+index1] -= cs1*h1*b1.s11;
-                                    f.df[3*nxd[0]+index1] -= cs1*h1*b1.s12;
-                                    f.df[4*nxd[0]+index1] -= cs1*h1*b1.s22;
-                                }
-                                if (data2) {
-                                    f.df[0*nxd[0]+index2] -= cs2*h2*b2.v1;
-                                    f.df[1*nxd[0]+index2] -= cs2*h2*b2.v2;
-                                    f.df[2*nxd[0]+index2] -= cs2*h2*b2.s11;
-                                    f.df[3*nxd[0]+index2] -= cs2*h2*b2.s12;
-                                    f.df[4*nxd[0]+index2] -= cs2*h2*b2.s22;
-                                }
-                                break;
-                            case 3:
-                                if (data1) {
-                                    f.df[0*nxd[0]+index1] -= cs1*h1*b1.v3;
-                                    f.df[1*nxd[0]+index1] -= cs1*h1*b1.s13;
-                                    f.df[2*nxd[0]+index1] -= cs1*h1*b1.s23;
-                                }
-                                if (data2) {
-                                    f.df[0*nxd[0]+index2] -= cs2*h2*b2.v3;
-                                    f.df[1*nxd[0]+index2] -= cs2*h2*b2.s13;
-                                    f.df[2*nxd[0]+index2] -= cs2*h2*b2.s23;
-                                }
-                        }
-                        
-                }
-                
-            }
-            
+template <int kind, bool plastic>
+inline void interface::add_sat(fields& f, const int index, const double c, const boundfields b, const bool normal) const {
+    // subtracts SAT term with wave speed times grid spacing factor c for fields b at a grid point
+    // the out of plane normal stress in mode 2 plastic problems only has a normal characteristic contribution
+    
+    const int n0 = nxd[0];
+    double* df = f.df;
+    
+    if (kind == 3) {
+        df[0*n0+index] -= c*b.v1;
+        df[1*n0+index] -= c*b.v2;
+        df[2*n0+index] -= c*b.v3;
+        df[3*n0+index] -= c*b.s11;
+        df[4*n0+index] -= c*b.s12;
+        df[5*n0+index] -= c*b.s13;
+        df[6*n0+index] -= c*b.s22;
+        df[7*n0+index] -= c*b.s23;
+        df[8*n0+index] -= c*b.s33;
+    } else if (kind == 2) {
+        df[0*n0+index] -= c*b.v1;
+        df[1*n0+index] -= c*b.v2;
+        df[2*n0+index] -= c*b.s11;
+        df[3*n0+index] -= c*b.s12;
+        df[4*n0+index] -= c*b.s22;
+        if (plastic && normal) {
+            df[5*n0+index] -= c*b.s33;
         }
-        
+    } else if (!normal) {
+        df[0*n0+index] -= c*b.v3;
+        df[1*n0+index] -= c*b.s13;
+        df[2*n0+index] -= c*b.s23;
     }
     
 }
 
-iffields interface::solve_interface(const boundfields b1, const boundfields b2, const double zp1, const double zs1, const double zp2, const double zs2, const int i, const int j, const double t) {
-    // solves boundary condition for a locked interface
-    
-    ifchar ifcp, ifcs1, ifcs2, ifchatp, ifchats1, ifchats2;
+template <int kind, bool hs>
+void interface::load_row(const int i, const fields& f) {
+    // loads fields and impedances for a row of interface points and rotates fields into normal/tangent frame
+    
+    // copy members to local variables so that the compiler knows they do not change in the loop
+    
+    const int nj = n_loc[1];
+    const int np = npts;
+    const int base = ibase+i*istride[0];
+    const int stride = istride[1];
+    const int delta2 = idelta;
+    const double* fr = frame;
+    double* r1[9];
+    double* r2[9];
+    
+    for (int c=0; c<9; c++) {
+        r1[c] = rot1[c];
+        r2[c] = rot2[c];
+    }
     
-    ifcp.v1 = b1.v1;
-    ifcp.v2 = b2.v1;
-    ifcp.s1 = b1.s11;
-    ifcp.s2 = b2.s11;
+    #pragma omp simd
+    for (int j=0; j<nj; j++) {
+        
+        const int p = i*nj+j;
+        const int index1 = base+j*stride;
+        const int index2 = index1+delta2;
+        
+        const boundframe r = {fr[0*np+p], fr[1*np+p], fr[2*np+p],
+                              fr[3*np+p], fr[4*np+p], fr[5*np+p],
+                              fr[6*np+p], fr[7*np+p], fr[8*np+p]};
+        
+        const boundfields b_rot1 = rotate_xy_nt(load_fields<kind,hs>(f, index1),r);
+        const boundfields b_rot2 = rotate_xy_nt(load_fields<kind,hs>(f, index2),r);
+        
+        r1[0][j] = b_rot1.v1;
+        r1[1][j] = b_rot1.v2;
+        r1[2][j] = b_rot1.v3;
+        r1[3][j] = b_rot1.s11;
+        r1[4][j] = b_rot1.s12;
+        r1[5][j] = b_rot1.s13;
+        r1[6][j] = b_rot1.s22;
+        r1[7][j] = b_rot1.s23;
+        r1[8][j] = b_rot1.s33;
+        r2[0][j] = b_rot2.v1;
+        r2[1][j] = b_rot2.v2;
+        r2[2][j] = b_rot2.v3;
+        r2[3][j] = b_rot2.s11;
+        r2[4][j] = b_rot2.s12;
+        r2[5][j] = b_rot2.s13;
+        r2[6][j] = b_rot2.s22;
+        r2[7][j] = b_rot2.s23;
+        r2[8][j] = b_rot2.s33;
+        
+    }
     
-    ifchatp = solve_locked(ifcp,zp1,zp2);
+    // impedances are only stored per point for heterogeneous materials (no P waves for mode 3)
     
-    ifcs1.v1 = b1.v2;
-    ifcs1.v2 = b2.v2;
-    ifcs1.s1 = b1.s12;
-    ifcs1.s2 = b2.s12;
+    load_impedance(zrow[0], zp1, (f.hetmat && data1 && kind != 1) ? f.matd+4*nxd[0] : 0, i, 0);
+    load_impedance(zrow[1], zs1, (f.hetmat && data1) ? f.matd+5*nxd[0] : 0, i, 0);
+    load_impedance(zrow[2], zp2, (f.hetmat && data2 && kind != 1) ? f.matd+4*nxd[0] : 0, i, idelta);
+    load_impedance(zrow[3], zs2, (f.hetmat && data2) ? f.matd+5*nxd[0] : 0, i, idelta);
     
-    ifchats1 = solve_locked(ifcs1,zs1,zs2);
+}
+
+void interface::load_impedance(double* z, const double zconst, const double* zhet, const int i, const int offset) const {
+    // sets impedance for a row of points, from array zhet if not null or to constant zconst otherwise
     
-    ifcs2.v1 = b1.v3;
-    ifcs2.v2 = b2.v3;
-    ifcs2.s1 = b1.s13;
-    ifcs2.s2 = b2.s13;
+    if (zhet) {
+        #pragma omp simd
+        for (int j=0; j<n_loc[1]; j++) {
+            z[j] = zhet[ibase+i*istride[0]+j*istride[1]+offset];
+        }
+    } else {
+        for (int j=0; j<n_loc[1]; j++) {
+            z[j] = zconst;
+        }
+    }
     
-    ifchats2 = solve_locked(ifcs2,zs1,zs2);
+}
+
+template <int kind, bool het, bool plastic>
+void interface::apply_row(const int i, const double dt, fields& f) const {
+    // rotates differences between fields and targets back to xyz and adds SAT terms for a row of interface points
+    // each side is done in a separate loop, and only if it is in this process
     
-    iffields iffout;
+    if (data1) {
+        apply_row_side<kind,het,plastic,1>(i, dt, f);
+    }
     
-    iffout.v11 = ifchatp.v1;
-    iffout.v21 = ifchatp.v2;
-    iffout.s11 = ifchatp.s1;
-    iffout.s21 = ifchatp.s2;
-    iffout.v12 = ifchats1.v1;
-    iffout.v22 = ifchats1.v2;
-    iffout.s12 = ifchats1.s1;
-    iffout.s22 = ifchats1.s2;
-    iffout.v13 = ifchats2.v1;
-    iffout.v23 = ifchats2.v2;
-    iffout.s13 = ifchats2.s1;
-    iffout.s23 = ifchats2.s2;
+    if (data2) {
+        apply_row_side<kind,het,plastic,2>(i, dt, f);
+    }
     
-    return iffout;
+}
 
+template <int kind, bool het, bool plastic, int side>
+void interface::apply_row_side(const int i, const double dt, fields& f) const {
+    // adds SAT terms for a row of interface points on one side of the interface
+    
+    // local copies of members for this side, as in load_row
+    
+    const int nj = n_loc[1];
+    const int n0 = nxd[0];
+    const int np = npts;
+    const int base = ibase+i*istride[0]+((side == 1) ? 0 : idelta);
+    const int stride = istride[1];
+    const int h = (side == 1) ? 0 : 6;
+    const double* fr = frame;
+    const double* dl = (side == 1) ? dl1 : dl2;
+    const double cpc = (side == 1) ? cp1 : cp2;
+    const double csc = (side == 1) ? cs1 : cs2;
+    const double gammac = (side == 1) ? gamma1 : gamma2;
+    const double* matd = f.matd;
+    const double* rt[6];
+    const double* ht[6];
+    
+    for (int c=0; c<6; c++) {
+        rt[c] = (side == 1) ? rot1[c] : rot2[c];
+        ht[c] = hat[h+c];
+    }
+    
+    #pragma omp simd
+    for (int j=0; j<nj; j++) {
+        
+        const int p = i*nj+j;
+        const int index = base+j*stride;
+        
+        const boundframe r = {fr[0*np+p], fr[1*np+p], fr[2*np+p],
+                              fr[3*np+p], fr[4*np+p], fr[5*np+p],
+                              fr[6*np+p], fr[7*np+p], fr[8*np+p]};
+        
+        // wave speeds and gamma are only stored per point for heterogeneous materials (no P waves for mode 3)
+        
+        const double cpp = (het && kind != 1) ? matd[2*n0+index] : cpc;
+        const double csp = het ? matd[3*n0+index] : csc;
+        const double gammap = (het && kind != 1) ? matd[6*n0+index] : gammac;
+        
+        boundfields b;
+        
+        // rotate normal targets back to xyz and add SAT term for normal characteristics
+        
+        if (kind != 1) {
+            b.v1 = rt[0][j]-ht[0][j];
+            b.v2 = 0.;
+            b.v3 = 0.;
+            b.s11 = rt[3][j]-ht[3][j];
+            b.s12 = 0.;
+            b.s13 = 0.;
+            b.s22 = gammap*(rt[3][j]-ht[3][j]);
+            b.s23 = 0.;
+            b.s33 = gammap*(rt[3][j]-ht[3][j]);
+            
+            add_sat<kind,plastic>(f, index, cpp*(dt*dl[p]), rotate_nt_xy(b,r), true);
+        }
+        
+        // rotate tangential targets back to xyz and add SAT term for tangential characteristics
+        
+        b.v1 = 0.;
+        b.v2 = rt[1][j]-ht[1][j];
+        b.v3 = rt[2][j]-ht[2][j];
+        b.s11 = 0.;
+        b.s12 = rt[4][j]-ht[4][j];
+        b.s13 = rt[5][j]-ht[5][j];
+        b.s22 = 0.;
+        b.s23 = 0.;
+        b.s33 = 0.;
+        
+        add_sat<kind,plastic>(f, index, csp*(dt*dl[p]), rotate_nt_xy(b,r), false);
+        
+    }
+    
 }
 
-ifchar interface::solve_locked(const ifchar ifc, const double z1, const double z2) {
-    // solves locked interface conditions for a single characteristic
+void interface::set_hat(const int j, const iffields iff) {
+    // stores target values of characteristics for point j in the current row
+    
+    hat[0][j] = iff.v11;
+    hat[1][j] = iff.v12;
+    hat[2][j] = iff.v13;
+    hat[3][j] = iff.s11;
+    hat[4][j] = iff.s12;
+    hat[5][j] = iff.s13;
+    hat[6][j] = iff.v21;
+    hat[7][j] = iff.v22;
+    hat[8][j] = iff.v23;
+    hat[9][j] = iff.s21;
+    hat[10][j] = iff.s22;
+    hat[11][j] = iff.s23;
     
-    ifchar ifcout;
+}
+
+void interface::calc_loads(const double t) {
+    // sets interface loads at time t
     
-    ifcout.s1 = (z2*(ifc.s1-z1*ifc.v1)+z1*(ifc.s2+z2*ifc.v2))/(z1+z2);
-    ifcout.s2 = ifcout.s1;
-    ifcout.v1 = (ifcout.s1-ifc.s1)/z1+ifc.v1;
-    ifcout.v2 = ifcout.v1;
+}
+
+void interface::solve_row(const int i, const double t) {
+    // solves boundary condition for a locked interface for a row of points
     
-    return ifcout;
+    #pragma omp simd
+    for (int j=0; j<n_loc[1]; j++) {
+        
+        ifchar ifcp, ifcs1, ifcs2, ifchatp, ifchats1, ifchats2;
+        
+        ifcp.v1 = rot1[0][j];
+        ifcp.v2 = rot2[0][j];
+        ifcp.s1 = rot1[3][j];
+        ifcp.s2 = rot2[3][j];
+        
+        ifchatp = solve_locked(ifcp,zrow[0][j],zrow[2][j]);
+        
+        ifcs1.v1 = rot1[1][j];
+        ifcs1.v2 = rot2[1][j];
+        ifcs1.s1 = rot1[4][j];
+        ifcs1.s2 = rot2[4][j];
+        
+        ifchats1 = solve_locked(ifcs1,zrow[1][j],zrow[3][j]);
+        
+        ifcs2.v1 = rot1[2][j];
+        ifcs2.v2 = rot2[2][j];
+        ifcs2.s1 = rot1[5][j];
+        ifcs2.s2 = rot2[5][j];
+        
+        ifchats2 = solve_locked(ifcs2,zrow[1][j],zrow[3][j]);
+        
+        iffields iffout;
+        
+        iffout.v11 = ifchatp.v1;
+        iffout.v21 = ifchatp.v2;
+        iffout.s11 = ifchatp.s1;
+        iffout.s21 = ifchatp.s2;
+        iffout.v12 = ifchats1.v1;
+        iffout.v22 = ifchats1.v2;
+        iffout.s12 = ifchats1.s1;
+        iffout.s22 = ifchats1.s2;
+        iffout.v13 = ifchats2.v1;
+        iffout.v23 = ifchats2.v2;
+        iffout.s13 = ifchats2.s1;
+        iffout.s23 = ifchats2.s2;
+        
+        set_hat(j, iffout);
+        
+    }
+
 }
 
 void interface::scale_df(const double A) {
@@ -50,13 +50,22 @@ protected:
     double zs2;
     double gamma1;
     double gamma2;
-    double*** nx;
-    double** dl1;
-    double** dl2;
+    int npts;
+    double* frame;
+    double* dl1;
+    double* dl2;
     int nxd[3];
     int mlb[3];
     int prb[3];
     int delta[3];
+    int ibase;
+    int istride[2];
+    int idelta;
+    double* rowbuf;
+    double* rot1[9];
+    double* rot2[9];
+    double* zrow[4];
+    double* hat[12];
     bool no_data;
     bool data1;
     bool data2;
@@ -71,10 +80,37 @@ protected:
     double* s;
     double* sn;
     double* state;
-    void allocate_normals(const double dx1[3], const double dx2[3], const fields& f, const fd_type& fd);
+    void allocate_normals(const double dx1[3], const double dx2[3], const bool rect1, const bool rect2,
+                          const double rmetric1[3], const double rmetric2[3], const fields& f, const fd_type& fd);
     void deallocate_normals();
-    virtual iffields solve_interface(const boundfields b1, const boundfields b2, const double zp1, const double zs1, const double zp2, const double zs2, const int i, const int j, const double t);
-    ifchar solve_locked(const ifchar ifc, const double z1, const double z2);
+    void (interface::*load_row_kernel)(const int i, const fields& f);
+    void (interface::*apply_row_kernel)(const int i, const double dt, fields& f) const;
+    void set_row_kernel(const fields& f);
+    template <int kind> void set_row_kernel_kind(const fields& f);
+    template <int kind, bool hs> boundfields load_fields(const fields& f, const int index) const;
+    template <int kind, bool plastic> void add_sat(fields& f, const int index, const double c, const boundfields b, const bool normal) const;
+    template <int kind, bool hs> void load_row(const int i, const fields& f);
+    void load_impedance(double* z, const double zconst, const double* zhet, const int i, const int offset) const;
+    template <int kind, bool het, bool plastic> void apply_row(const int i, const double dt, fields& f) const;
+    template <int kind, bool het, bool plastic, int side> void apply_row_side(const int i, const double dt, fields& f) const;
+    void set_hat(const int j, const iffields iff);
+    virtual void calc_loads(const double t);
+    virtual void solve_row(const int i, const double t);
+    ifchar solve_locked(const ifchar ifc, const double z1, const double z2) const;
 };
 
+inline ifchar interface::solve_locked(const ifchar ifc, const double z1, const double z2) const {
+    // solves locked interface conditions for a single characteristic
+    // defined in header so that row loops in derived interfaces can inline it
+    
+    ifchar ifcout;
+    
+    ifcout.s1 = (z2*(ifc.s1-z1*ifc.v1)+z1*(ifc.s2+z2*ifc.v2))/(z1+z2);
+    ifcout.s2 = ifcout.s1;
+    ifcout.v1 = (ifcout.s1-ifc.s1)/z1+ifc.v1;
+    ifcout.v2 = ifcout.v1;
+    
+    return ifcout;
+}
+
 #endif
\ No newline at end of file
@@ -6,8 +6,8 @@
 #include "pert.hpp"
 
 load::load(const std::string type_in, const double t0_in, const double x0_in, const double dx_in,
-           const double y0_in, const double dy_in, const int n[2], const int xm[2], const int xm_loc[2],
-           const double x[2], const double l[2], const double sn_in, const double s2_in,
+           const double y0_in, const double dy_in, const int n[2], const int n_loc[2], const int xm[2],
+           const int xm_loc[2], const double x[2], const double l[2], const double sn_in, const double s2_in,
            const double s3_in) : pert(type_in, t0_in, x0_in, dx_in, y0_in, dy_in, n, xm, xm_loc, x, l) {
     // constructor
 	
@@ -15,23 +15,37 @@ load::load(const std::string type_in, const double t0_in, const double x0_in, co
     s2 = s2_in;
     s3 = s3_in;
     
-}
-
-double load::get_s2(const int i, const int j, const double t) const {
-    // returns shear load perturbation
+    // spatial dependence does not change with time, so evaluate once for all local points
+    
+    npts = n_loc[0]*n_loc[1];
+    
+    xy = new double [npts];
+    
+    for (int i=0; i<n_loc[0]; i++) {
+        for (int j=0; j<n_loc[1]; j++) {
+            xy[i*n_loc[1]+j] = xyfunc(i,j);
+        }
+    }
     
-    return s2*xyfunc(i,j)*tfunc(t);
 }
 
-double load::get_s3(const int i, const int j, const double t) const {
-    // returns shear load perturbation
+load::~load() {
+    // destructor
+    
+    delete[] xy;
     
-    return s3*xyfunc(i,j)*tfunc(t);
 }
 
-double load::get_sn(const int i, const int j, const double t) const {
-    // returns normal load perturbation
+void load::add_load(const double t, double* snl, double* s2l, double* s3l) const {
+    // adds load at time t to normal and shear traction arrays
+    
+    const double tval = tfunc(t);
+    
+    #pragma omp simd
+    for (int i=0; i<npts; i++) {
+        snl[i] += sn*xy[i]*tval;
+        s2l[i] += s2*xy[i]*tval;
+        s3l[i] += s3*xy[i]*tval;
+    }
     
-    return sn*xyfunc(i,j)*tfunc(t);
-
 }
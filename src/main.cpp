@@ -2,6 +2,9 @@
 #include <time.h>
 #include "problem.hpp"
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -12,8 +15,15 @@ int main(int argc, char* argv[]) {
     struct tm* timeinfo;
 
 	// start MPI
+	// if compiled with OpenMP, only the main thread makes MPI calls
 	
+#ifdef _OPENMP
+    int provided;
+    
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+#else
 	MPI_Init(&argc, &argv);
+#endif
 	
 	MPI_Comm_size(MPI_COMM_WORLD, &np);
 	
@@ -23,6 +33,12 @@ int main(int argc, char* argv[]) {
     
     if (id==0) {
         cout << "fdfault called with " << np << " processes\n";
+#ifdef _OPENMP
+        cout << "Using " << omp_get_max_threads() << " threads per process\n";
+        if (provided < MPI_THREAD_FUNNELED) {
+            cout << "MPI library does not support threads, OpenMP regions may be unsafe\n";
+        }
+#endif
     }
 	
     // get input file from command line
@@ -360,6 +360,7 @@ outputunit::outputunit(const string probname, const string datadir, const int nt
     // set local spatial limits
     
     no_data = false;
+    convert = false;
     
     for (int i=0; i<3; i++) {
         if (location == -1) {
@@ -487,6 +488,17 @@ outputunit::outputunit(const string probname, const string datadir, const int nt
         }
     }
     
+    // stresses are stored relative to the initial stress, which is added to the data as it is written
+    
+    stress = (location == -1 && field >= d.f->nv && field < d.f->nv+d.f->ns);
+    s0 = 0.;
+    sstart = 0;
+    
+    if (stress) {
+        s0 = d.f->s0[d.f->index[field-d.f->nv]];
+        sstart = start-d.f->nv*d.cart->get_nx_tot(0)*d.cart->get_nx_tot(1)*d.cart->get_nx_tot(2);
+    }
+    
     // create communcator for appropriate processes
     
     comm = create_comm(no_data);
@@ -543,11 +555,21 @@ outputunit::outputunit(const string probname, const string datadir, const int nt
             }
         }
     
-        MPI_Type_create_indexed_block(ntot, 1, disp, MPI_DOUBLE, &dataarray);
+        // stresses and fields stored in single precision are converted into a contiguous double buffer before writing
+        
+        convert = (location == -1 && (stress || sizeof(fieldreal) != sizeof(double)));
+        
+        if (convert) {
+            nbuf = ntot;
+            bufdisp = disp;
+            buf = new double [nbuf];
+            MPI_Type_contiguous(ntot, MPI_DOUBLE, &dataarray);
+        } else {
+            MPI_Type_create_indexed_block(ntot, 1, disp, MPI_DOUBLE, &dataarray);
+            delete[] disp;
+        }
     
         MPI_Type_commit(&dataarray);
-    
-        delete[] disp;
         
         // filearray uses subarray to describe layout in file
         
@@ -614,11 +636,18 @@ outputunit::outputunit(const string probname, const string datadir, const int nt
             }
         }
         
-        MPI_Type_create_indexed_block(ntot, 1, disp, MPI_DOUBLE, &xarray);
+        // grid stored in single precision is converted into a contiguous double buffer before writing
         
-        MPI_Type_commit(&xarray);
+        double* xbuf = 0;
         
-        delete[] disp;
+        if (sizeof(gridreal) != sizeof(double)) {
+            xbuf = new double [ntot];
+            MPI_Type_contiguous(ntot, MPI_DOUBLE, &xarray);
+        } else {
+            MPI_Type_create_indexed_block(ntot, 1, disp, MPI_DOUBLE, &xarray);
+        }
+        
+        MPI_Type_commit(&xarray);
         
         for (int i=0; i<ndim; i++) {
                 
@@ -656,7 +685,14 @@ outputunit::outputunit(const string probname, const string datadir, const int nt
             
             // write data
             
-            MPI_File_write(xfile, &(d.f->x[xstart]), 1, xarray, MPI_STATUS_IGNORE);
+            if (xbuf) {
+                for (int j=0; j<ntot; j++) {
+                    xbuf[j] = (double)d.f->x[xstart+disp[j]];
+                }
+                MPI_File_write(xfile, xbuf, 1, xarray, MPI_STATUS_IGNORE);
+            } else {
+                MPI_File_write(xfile, &(d.f->x[xstart]), 1, xarray, MPI_STATUS_IGNORE);
+            }
             
             // close file
             
@@ -666,6 +702,12 @@ outputunit::outputunit(const string probname, const string datadir, const int nt
         
         MPI_Type_free(&xarray);
         
+        delete[] disp;
+        
+        if (xbuf) {
+            delete[] xbuf;
+        }
+        
     }
     
     // if master, open files for time output, matlab, and python
@@ -752,6 +794,11 @@ void outputunit::close_file() {
     
     MPI_File_close(&outfile);
     
+    if (convert) {
+        delete[] buf;
+        delete[] bufdisp;
+    }
+    
     MPI_Type_free(&dataarray);
     MPI_Type_free(&filearray);
 }
@@ -788,7 +835,24 @@ void outputunit::write_unit(const int tstep, const double dt, const domain& d) c
     
     switch (location) {
         case -1:
-            MPI_File_write(outfile, &(d.f->f[start]), 1, dataarray, MPI_STATUS_IGNORE);
+            if (stress) {
+                for (int i=0; i<nbuf; i++) {
+                    buf[i] = (double)d.f->f[start+bufdisp[i]]+s0;
+                }
+                if (d.f->hetstress) {
+                    for (int i=0; i<nbuf; i++) {
+                        buf[i] += d.f->s[sstart+bufdisp[i]];
+                    }
+                }
+                MPI_File_write(outfile, buf, 1, dataarray, MPI_STATUS_IGNORE);
+            } else if (convert) {
+                for (int i=0; i<nbuf; i++) {
+                    buf[i] = (double)d.f->f[start+bufdisp[i]];
+                }
+                MPI_File_write(outfile, buf, 1, dataarray, MPI_STATUS_IGNORE);
+            } else {
+                MPI_File_write(outfile, &(d.f->f[start]), 1, dataarray, MPI_STATUS_IGNORE);
+            }
             break;
         default:
             switch (ndim) {
@@ -34,6 +34,13 @@ private:
     int location;
     int iface;
     int start;
+    bool convert;
+    bool stress;
+    double s0;
+    int sstart;
+    int nbuf;
+    int* bufdisp;
+    double* buf;
     outputunit* next;
     std::ofstream* tfile;
     MPI_File outfile;
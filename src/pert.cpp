@@ -42,6 +42,12 @@ pert::pert(const std::string type_in, const double t0_in, const double x0_in, co
     
 }
 
+bool pert::time_dependent() const {
+    // returns true if perturbation ramps up in time (spatial dependence is fixed)
+    
+    return (t0 > 0.);
+}
+
 double pert::tfunc(const double t) const {
     // load time ramp
     
@@ -9,6 +9,7 @@ public:
     pert(const std::string type_in, const double t0_in, const double x0_in, const double dx_in,
          const double y0_in, const double dy_in, const int n[2], const int xm[2], const int xm_loc[2],
          const double x[2], const double l[2]);
+    bool time_dependent() const;
 protected:
     int type;
     int direction;
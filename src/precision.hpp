@@ -0,0 +1,31 @@
+#ifndef PRECISIONHEADERDEF
+#define PRECISIONHEADERDEF
+
+#include <mpi.h>
+
+// storage types for grid and field arrays, selected at compile time
+// by default everything is stored in double precision. compiling with -DSINGLE_GRID stores the coordinates,
+// metric derivatives, jacobian, and precomputed grid coefficients in single precision, and -DSINGLE_FIELDS
+// additionally stores the fields. rates stay in double precision, and stored values are promoted to double
+// when combined with the double precision stencil coefficients, so stencil sums are accumulated in double
+
+#ifdef SINGLE_FIELDS
+#ifndef SINGLE_GRID
+#define SINGLE_GRID
+#endif
+typedef float fieldreal;
+#define MPI_FIELDREAL MPI_FLOAT
+#else
+typedef double fieldreal;
+#define MPI_FIELDREAL MPI_DOUBLE
+#endif
+
+#ifdef SINGLE_GRID
+typedef float gridreal;
+#define MPI_GRIDREAL MPI_FLOAT
+#else
+typedef double gridreal;
+#define MPI_GRIDREAL MPI_DOUBLE
+#endif
+
+#endif
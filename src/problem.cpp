@@ -9,6 +9,7 @@
 #include "frontlist.hpp"
 #include "outputlist.hpp"
 #include "rk.hpp"
+#include "timer.hpp"
 #include <mpi.h>
 
 using namespace std;
@@ -55,7 +56,7 @@ problem::problem(const char* filename) {
     
     // set up problem
     
-    d = new domain(filename);
+    d = new domain(filename, rk->get_nstages());
     
     // set time step
         
@@ -69,14 +70,10 @@ problem::problem(const char* filename) {
     
     front = new frontlist(filename, name, datadir, *d);
     
-    // write initial output data (uses absolute stress values)
-    
-    d->set_stress();
+    // write initial output data (initial stress is added to stress output)
     
     out->write_list(0, dt, *d);
     
-    d->remove_stress();
-    
     // set initial values of rupture front
     
     front->set_front(0., *d);
@@ -148,35 +145,46 @@ void problem::solve() {
 	
 	nstages = rk->get_nstages();
     
+    tm.start(timer::total);
+    
     for (int i=0; i<nt; i++) {
         // advance domain by a time step by looping over RK stages
         
         for (int stage=0; stage<nstages; stage++) {
-            d->do_rk_stage(dt,stage,(double)i*dt,*rk);
+            d->do_rk_stage(dt,stage,(double)i*dt,*rk,tm);
         }
         
-        // output data (uses absolute stress values)
+        // output data (initial stress is added to stress output)
         
-        d->set_stress();
+        tm.start(timer::output);
         
         out->write_list(i+1, dt, *d);
-
-        d->remove_stress();
+        
+        tm.stop(timer::output);
         
         // update front
         
+        tm.start(timer::front);
+        
         front->set_front((double)(i+1)*dt, *d);
         
+        tm.stop(timer::front);
+        
         // update status
         
-        if (id == 0 && (i+1)%ninfo == 0) {
-            time (&rawtime);
-            timeinfo = localtime (&rawtime);
-            std::cout << "Timestep " << i+1 << " of " << nt << " " << asctime(timeinfo);
+        if ((i+1)%ninfo == 0) {
+            if (id == 0) {
+                time (&rawtime);
+                timeinfo = localtime (&rawtime);
+                std::cout << "Timestep " << i+1 << " of " << nt << " " << asctime(timeinfo);
+            }
+            d->write_plastic_info();
         }
         
     }
     
+    tm.stop(timer::total);
+    
     // close output files
     
     out->close_list();
@@ -185,8 +193,14 @@ void problem::solve() {
     
     front->write_list(*d);
     
-    // free MPI data types for boundary exchange
+    // report ghost cell exchange statistics and free buffers for boundary exchange
+    
+    d->write_exchange_info();
     
     d->free_exchange();
     
+    // report time spent in each phase
+    
+    tm.write_timer(name, datadir);
+    
 }
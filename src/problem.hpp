@@ -6,6 +6,7 @@
 #include "frontlist.hpp"
 #include "outputlist.hpp"
 #include "rk.hpp"
+#include "timer.hpp"
 
 class problem
 {
@@ -26,6 +27,7 @@ private:
     rk_type* rk;
 	outputlist* out;
     frontlist* front;
+    timer tm;
     void set_time_step();
 };
 
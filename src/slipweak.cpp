@@ -153,6 +153,19 @@ slipweak::slipweak(const char* filename, const int ndim_in, const int mode_in, c
     delete[] truptmp;
     delete[] tctmp;
     
+    // allocate memory for parameters
+    
+    if (!no_data) {
+        
+        dc = new double [n_loc[0]*n_loc[1]];
+        mus = new double [n_loc[0]*n_loc[1]];
+        mud = new double [n_loc[0]*n_loc[1]];
+        c0 = new double [n_loc[0]*n_loc[1]];
+        trup = new double [n_loc[0]*n_loc[1]];
+        tc = new double [n_loc[0]*n_loc[1]];
+        
+    }
+    
     // if needed, read parameters from file
     
     if (swparamfile == "none") {
@@ -160,24 +173,61 @@ slipweak::slipweak(const char* filename, const int ndim_in, const int mode_in, c
     } else {
         param_file = true;
         
-        // allocate memory for parameters
-        
-        if (!no_data) {
-            
-            dc = new double [n_loc[0]*n_loc[1]];
-            mus = new double [n_loc[0]*n_loc[1]];
-            mud = new double [n_loc[0]*n_loc[1]];
-            c0 = new double [n_loc[0]*n_loc[1]];
-            trup = new double [n_loc[0]*n_loc[1]];
-            tc = new double [n_loc[0]*n_loc[1]];
-            
-        }
-        
         // read parameters for each potential side of process (if both sides in process, may be read twice)
         
         read_params(swparamfile, !data1);
         read_params(swparamfile, !data2);
     }
+    
+    // evaluate perturbations that do not change with time once and add to parameter arrays
+    // only perturbations that ramp up in time are kept to be evaluated during the simulation
+    
+    if (!no_data) {
+        
+        for (int i=0; i<n_loc[0]; i++) {
+            for (int j=0; j<n_loc[1]; j++) {
+                double dct = 0., must = 0., mudt = 0., c0t = 0., trupt = 0., tct = 0.;
+                for (int k=0; k<nperts; k++) {
+                    if (perts[k]->time_dependent()) { continue; }
+                    dct += perts[k]->get_dc(i, j, 0.);
+                    must += perts[k]->get_mus(i, j, 0.);
+                    mudt += perts[k]->get_mud(i, j, 0.);
+                    c0t += perts[k]->get_c0(i, j, 0.);
+                    trupt += perts[k]->get_trup(i, j, 0.);
+                    tct += perts[k]->get_tc(i, j, 0.);
+                }
+                const int index = i*n_loc[1]+j;
+                if (param_file) {
+                    dct += dc[index];
+                    must += mus[index];
+                    mudt += mud[index];
+                    c0t += c0[index];
+                    trupt += trup[index];
+                    tct += tc[index];
+                }
+                dc[index] = dct;
+                mus[index] = must;
+                mud[index] = mudt;
+                c0[index] = c0t;
+                trup[index] = trupt;
+                tc[index] = tct;
+            }
+        }
+        
+        int ntime = 0;
+        
+        for (int k=0; k<nperts; k++) {
+            if (perts[k]->time_dependent()) {
+                perts[ntime] = perts[k];
+                ntime++;
+            } else {
+                delete perts[k];
+            }
+        }
+        
+        nperts = ntime;
+        
+    }
 
 }
 
@@ -192,119 +242,92 @@ slipweak::~slipweak() {
     
     delete[] perts;
     
-    if (param_file) {
-        delete[] dc;
-        delete[] mus;
-        delete[] mud;
-        delete[] c0;
-        delete[] trup;
-        delete[] tc;
-    }
+    delete[] dc;
+    delete[] mus;
+    delete[] mud;
+    delete[] c0;
+    delete[] trup;
+    delete[] tc;
     
 }
 
-boundchar slipweak::solve_fs(const double phi, const double eta, const double snc, const int i, const int j, const double t) {
-    // solves slip weakening law for slip velocity and strength (must override standard version because of cohesion)
+void slipweak::calc_mu_row(const int i, const double t) {
+    // calculates friction coefficient and cohesion for row i
     
-    double c0t = 0.;
+    const int nj = n_loc[1];
     
-    for (int k=0; k<nperts; k++) {
-        c0t += perts[k]->get_c0(i, j, t);
-    }
+    const double* dcr = dc+i*nj;
+    const double* musr = mus+i*nj;
+    const double* mudr = mud+i*nj;
+    const double* trupr = trup+i*nj;
+    const double* tcr = tc+i*nj;
     
-    const int index = i*n_loc[1]+j;
-    
-    if (param_file) {
-        c0t += c0[index];
+    for (int j=0; j<nj; j++) {
+        crow[j] = c0[i*nj+j];
     }
     
-    boundchar b;
+    // add any perturbations that ramp up in time
     
-    if (snc < 0.) {
-        // compressive normal stress
-        
-        double mu = calc_mu(phi, eta, snc, i, j, t);
+    if (nperts > 0) {
         
-        if (c0t+mu*fabs(snc) > phi) {
-            // locked
-            b.v = 0.;
-            b.s = phi;
-        } else {
-            // slipping
-            b.s = c0t+mu*fabs(snc);
-            b.v = (phi-b.s)/eta;
+        for (int j=0; j<nj; j++) {
+            prow[0][j] = dcr[j];
+            prow[1][j] = musr[j];
+            prow[2][j] = mudr[j];
+            prow[3][j] = trupr[j];
+            prow[4][j] = tcr[j];
         }
         
-    } else {
-        // tensile normal stress
-        if (phi > c0t) {
-            // slipping
-            b.s = c0t;
-            b.v = (phi-b.s)/eta;
-        } else {
-            b.v = 0.;
-            b.s = phi;
+        for (int k=0; k<nperts; k++) {
+            for (int j=0; j<nj; j++) {
+                prow[0][j] += perts[k]->get_dc(i, j, t);
+                prow[1][j] += perts[k]->get_mus(i, j, t);
+                prow[2][j] += perts[k]->get_mud(i, j, t);
+                prow[3][j] += perts[k]->get_trup(i, j, t);
+                prow[4][j] += perts[k]->get_tc(i, j, t);
+                crow[j] += perts[k]->get_c0(i, j, t);
+            }
         }
+        
+        dcr = prow[0];
+        musr = prow[1];
+        mudr = prow[2];
+        trupr = prow[3];
+        tcr = prow[4];
+        
     }
     
-    return b;
-}
-
-double slipweak::calc_mu(const double phi, const double eta, const double snc, const int i, const int j, const double t) const {
-    // calculates friciton coefficient for index i,j
-    
-    double mu, f1, f2, dct = 0., mudt = 0., must = 0., trupt = 0., tct = 0.;
-    
-    for (int k=0; k<nperts; k++) {
-        dct += perts[k]->get_dc(i, j, t);
-        must += perts[k]->get_mus(i, j, t);
-        mudt += perts[k]->get_mud(i, j, t);
-        trupt += perts[k]->get_trup(i, j, t);
-        tct += perts[k]->get_tc(i, j, t);
-    }
-    
-    const int index = i*n_loc[1]+j;
-    
-    if (param_file) {
-        dct += dc[index];
-        must += mus[index];
-        mudt += mud[index];
-        trupt += trup[index];
-        tct += tc[index];
-    }
-    
-    // slip weakening
+    // slip and friction coefficient pointers for the row
     
-    if (dct == 0. || u[index] >= dct) {
-        f1 = 1.;
-    } else {
-        f1 = u[index]/dct;
-    }
+    const double* ur = u+i*nj;
+    double* mur = murow;
     
-    // time weakening
-    
-    if (trupt <= 0. || t < trupt) {
-        f2 = 0.;
-    } else if (t >= trupt && t < trupt+tct) {
-		if (tct == 0.) {
-			f2 = 1.;
-		} else {
-			f2 = (t-trupt)/tct;
-		}
-    } else {
-        f2 = 1.;
-    }
-    
-    // actual friction law based on max of two weakening types
-    
-    if (f1 >= f2) {
-        mu = must+(mudt-must)*f1;
-    } else {
-        mu = must+(mudt-must)*f2;
+    #pragma omp simd
+    for (int j=0; j<nj; j++) {
+        
+        const double dct = dcr[j], must = musr[j], mudt = mudr[j], trupt = trupr[j], tct = tcr[j];
+        const double ut = ur[j];
+        
+        // weakening ratios are computed for all points and discarded where they do not apply
+        
+        const double uratio = ut/dct;
+        const double tratio = (t-trupt)/tct;
+        
+        // slip weakening
+        
+        const double f1 = (dct == 0. || ut >= dct) ? 1. : uratio;
+        
+        // time weakening
+        
+        const double f2ramp = (tct == 0.) ? 1. : tratio;
+        const double f2 = (trupt <= 0. || t < trupt) ? 0. : ((t < trupt+tct) ? f2ramp : 1.);
+        
+        // actual friction law based on max of two weakening types
+        
+        mur[j] = must+(mudt-must)*((f1 >= f2) ? f1 : f2);
+        
     }
     
-    return mu;
-    
 }
 
 void slipweak::read_params(const string paramfile, const bool data_proc) {
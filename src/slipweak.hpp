@@ -22,8 +22,7 @@ protected:
     double* trup;
     double* tc;
     virtual void read_params(const std::string paramfile, const bool data_proc);
-    virtual boundchar solve_fs(const double phi, const double eta, const double snc, const int i, const int j, const double t);
-    virtual double calc_mu(const double phi, const double eta, const double snc, const int i, const int j, const double t) const;
+    virtual void calc_mu_row(const int i, const double t);
 };
 
 #endif
\ No newline at end of file
@@ -200,6 +200,22 @@ stz::stz(const char* filename, const int ndim_in, const int mode_in, const strin
     delete[] chiwtmp;
     delete[] v1tmp;
     
+    // allocate memory for parameters
+    
+    if (!no_data) {
+        
+        v0 = new double [n_loc[0]*n_loc[1]];
+        f0 = new double [n_loc[0]*n_loc[1]];
+        a = new double [n_loc[0]*n_loc[1]];
+        muy = new double [n_loc[0]*n_loc[1]];
+        c0 = new double [n_loc[0]*n_loc[1]];
+        R = new double [n_loc[0]*n_loc[1]];
+        beta = new double [n_loc[0]*n_loc[1]];
+        chiw = new double [n_loc[0]*n_loc[1]];
+        v1 = new double [n_loc[0]*n_loc[1]];
+        
+    }
+    
     // if needed, read parameters from file
     
     if (stzparamfile == "none") {
@@ -207,27 +223,58 @@ stz::stz(const char* filename, const int ndim_in, const int mode_in, const strin
     } else {
         param_file = true;
         
-        // allocate memory for parameters
-        
-        if (!no_data) {
-            
-            v0 = new double [n_loc[0]*n_loc[1]];
-            f0 = new double [n_loc[0]*n_loc[1]];
-            a = new double [n_loc[0]*n_loc[1]];
-            muy = new double [n_loc[0]*n_loc[1]];
-            c0 = new double [n_loc[0]*n_loc[1]];
-            R = new double [n_loc[0]*n_loc[1]];
-            beta = new double [n_loc[0]*n_loc[1]];
-            chiw = new double [n_loc[0]*n_loc[1]];
-            v1 = new double [n_loc[0]*n_loc[1]];
-            
-        }
-        
         // read parameters on for processes on both sides (if both sides in process, may be read twice)
         
         read_params(stzparamfile, !data1);
         read_params(stzparamfile, !data2);
     }
+    
+    // evaluate perturbations that do not change with time once and add to parameter arrays
+    // only perturbations that ramp up in time are kept to be evaluated during the simulation
+    
+    if (!no_data) {
+        
+        double* params[9] = {v0, f0, a, muy, c0, R, beta, chiw, v1};
+        
+        for (int i=0; i<n_loc[0]; i++) {
+            for (int j=0; j<n_loc[1]; j++) {
+                double pt[9] = {0., 0., 0., 0., 0., 0., 0., 0., 0.};
+                for (int k=0; k<nperts; k++) {
+                    if (perts[k]->time_dependent()) { continue; }
+                    pt[0] += perts[k]->get_v0(i, j, 0.);
+                    pt[1] += perts[k]->get_f0(i, j, 0.);
+                    pt[2] += perts[k]->get_a(i, j, 0.);
+                    pt[3] += perts[k]->get_muy(i, j, 0.);
+                    pt[4] += perts[k]->get_c0(i, j, 0.);
+                    pt[5] += perts[k]->get_R(i, j, 0.);
+                    pt[6] += perts[k]->get_beta(i, j, 0.);
+                    pt[7] += perts[k]->get_chiw(i, j, 0.);
+                    pt[8] += perts[k]->get_v1(i, j, 0.);
+                }
+                const int index = i*n_loc[1]+j;
+                for (int p=0; p<9; p++) {
+                    if (param_file) {
+                        pt[p] += params[p][index];
+                    }
+                    params[p][index] = pt[p];
+                }
+            }
+        }
+        
+        int ntime = 0;
+        
+        for (int k=0; k<nperts; k++) {
+            if (perts[k]->time_dependent()) {
+                perts[ntime] = perts[k];
+                ntime++;
+            } else {
+                delete perts[k];
+            }
+        }
+        
+        nperts = ntime;
+        
+    }
 
 }
 
@@ -246,92 +293,138 @@ stz::~stz() {
     delete[] dstate;
     delete[] dstatedt;
     
-    if (param_file) {
-        delete[] v0;
-        delete[] f0;
-        delete[] a;
-        delete[] muy;
-        delete[] c0;
-        delete[] R;
-        delete[] beta;
-        delete[] chiw;
-        delete[] v1;
-    }
+    delete[] v0;
+    delete[] f0;
+    delete[] a;
+    delete[] muy;
+    delete[] c0;
+    delete[] R;
+    delete[] beta;
+    delete[] chiw;
+    delete[] v1;
     
 }
 
-double stz::calc_mu(const double phi, const double eta, const double snc, const int i, const int j, const double t) const {
-    // calculates friciton coefficient for index i,j and time t
-    
-    // pack parameters into array
+void stz::calc_mu_row(const int i, const double t) {
+    // calculates friction coefficient for row i and time t
     
-    double* params;
+    const int nj = n_loc[1];
     
-    params = new double [8];
+    const double* v0r = v0+i*nj;
+    const double* f0r = f0+i*nj;
+    const double* ar = a+i*nj;
+    const double* muyr = muy+i*nj;
     
-    int index = i*n_loc[1]+j;
+    // add any perturbations that ramp up in time
     
-    params[0] = phi;
-    params[1] = eta;
-    params[2] = snc;
-    params[3] = state[index];
-    params[4] = 0.;
-    params[5] = 0.;
-    params[6] = 0.;
-    params[7] = 0.;
-    
-    for (int k=0; k<nperts; k++) {
-        params[4] += perts[k]->get_v0(i, j, t);
-        params[5] += perts[k]->get_f0(i, j, t);
-        params[6] += perts[k]->get_a(i, j, t);
-        params[7] += perts[k]->get_muy(i, j, t);
+    if (nperts > 0) {
+        
+        for (int j=0; j<nj; j++) {
+            prow[0][j] = v0r[j];
+            prow[1][j] = f0r[j];
+            prow[2][j] = ar[j];
+            prow[3][j] = muyr[j];
+        }
+        
+        for (int k=0; k<nperts; k++) {
+            for (int j=0; j<nj; j++) {
+                prow[0][j] += perts[k]->get_v0(i, j, t);
+                prow[1][j] += perts[k]->get_f0(i, j, t);
+                prow[2][j] += perts[k]->get_a(i, j, t);
+                prow[3][j] += perts[k]->get_muy(i, j, t);
+            }
+        }
+        
+        v0r = prow[0];
+        f0r = prow[1];
+        ar = prow[2];
+        muyr = prow[3];
+        
     }
     
-    if (param_file) {
-        params[4] += v0[index];
-        params[5] += f0[index];
-        params[6] += a[index];
-        params[7] += muy[index];
-    }
+    // pack parameters into array and solve for friction coefficient where normal stress is compressive
     
-    double mu;
+    double params[8];
     
-    if (params[7] >= -phi/snc) {
-        mu = -phi/snc;
-    } else {
-        mu =  solve_newton(params[7], -phi/snc, params, &stz_func, &stz_der);
+    for (int j=0; j<nj; j++) {
+        
+        crow[j] = 0.;
+        
+        const double phi = phirow[0][j], snc = snrow[j];
+        
+        if (snc >= 0.) {
+            murow[j] = 0.;
+            continue;
+        }
+        
+        params[0] = phi;
+        params[1] = etarow[j];
+        params[2] = snc;
+        params[3] = state[i*nj+j];
+        params[4] = v0r[j];
+        params[5] = f0r[j];
+        params[6] = ar[j];
+        params[7] = muyr[j];
+        
+        if (params[7] >= -phi/snc) {
+            murow[j] = -phi/snc;
+        } else {
+            murow[j] = solve_newton(params[7], -phi/snc, params, &stz_func, &stz_der);
+        }
+        
     }
     
-    delete[] params;
-    
-    return mu;
-    
 }
 
-double stz::calc_dstatedt(const double vhat, const double shat, const int i, const int j, const double t) const {
-    // calculates time derivative of state variable using hat variables
+void stz::calc_dstatedt_row(const int i, const double t) {
+    // calculates time derivative of state variable using hat variables for row i
     
-    double c0t = 0., Rt = 0., betat = 0., chiwt = 0., v1t = 0.;
+    const int nj = n_loc[1];
     
-    for (int k=0; k<nperts; k++) {
-        c0t += perts[k]->get_c0(i, j, t);
-        Rt += perts[k]->get_R(i, j, t);
-        betat += perts[k]->get_beta(i, j, t);
-        chiwt += perts[k]->get_chiw(i, j, t);
-        v1t += perts[k]->get_v1(i, j, t);
-    }
+    const double* c0r = c0+i*nj;
+    const double* Rr = R+i*nj;
+    const double* betar = beta+i*nj;
+    const double* chiwr = chiw+i*nj;
+    const double* v1r = v1+i*nj;
     
-    const int index = i*n_loc[1]+j;
+    // add any perturbations that ramp up in time
     
-    if (param_file) {
-        c0t += c0[index];
-        Rt += R[index];
-        betat += beta[index];
-        chiwt += chiw[index];
-        v1t += v1[index];
+    if (nperts > 0) {
+        
+        for (int j=0; j<nj; j++) {
+            prow[0][j] = c0r[j];
+            prow[1][j] = Rr[j];
+            prow[2][j] = betar[j];
+            prow[3][j] = chiwr[j];
+            prow[4][j] = v1r[j];
+        }
+        
+        for (int k=0; k<nperts; k++) {
+            for (int j=0; j<nj; j++) {
+                prow[0][j] += perts[k]->get_c0(i, j, t);
+                prow[1][j] += perts[k]->get_R(i, j, t);
+                prow[2][j] += perts[k]->get_beta(i, j, t);
+                prow[3][j] += perts[k]->get_chiw(i, j, t);
+                prow[4][j] += perts[k]->get_v1(i, j, t);
+            }
+        }
+        
+        c0r = prow[0];
+        Rr = prow[1];
+        betar = prow[2];
+        chiwr = prow[3];
+        v1r = prow[4];
+        
     }
     
-    return vhat*shat/c0t*(1.-state[index]/chihat(vhat, chiwt, v1t))-Rt*exp(-betat/state[index]);
+    for (int j=0; j<nj; j++) {
+        
+        const int index = i*nj+j;
+        const double vhat = vrow[j], shat = srow[j];
+        
+        dstatedt[index] = vhat*shat/c0r[j]*(1.-state[index]/chihat(vhat, chiwr[j], v1r[j]))-Rr[j]*exp(-betar[j]/state[index]);
+        
+    }
     
 }
 
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cassert>
+#include <string>
+#include "timer.hpp"
+#include <mpi.h>
+
+using namespace std;
+
+// names of timed phases, used for output
+
+static const char* phase_names[timer::nphases] = {"scale_df", "calc_df", "df_interior", "df_closure", "set_boundaries",
+                                                  "exchange", "iface_bcs", "iface_calc_df", "iface_update", "update",
+                                                  "plastic", "output", "front", "total"};
+
+timer::timer() {
+    // constructor, sets all elapsed times to zero
+
+    for (int i=0; i<nphases; i++) {
+        t0[i] = 0.;
+        elapsed[i] = 0.;
+    }
+}
+
+void timer::start(const int phase) {
+    // starts timing a phase
+    assert(phase >= 0 && phase < nphases);
+
+    t0[phase] = MPI_Wtime();
+}
+
+void timer::stop(const int phase) {
+    // stops timing a phase and adds time since start to total for that phase
+    assert(phase >= 0 && phase < nphases);
+
+    elapsed[phase] += MPI_Wtime()-t0[phase];
+}
+
+bool timer::is_subphase(const int phase) {
+    // returns true for phases timed within another phase (interior and closure kernels within calc_df)
+    
+    return (phase == df_interior || phase == df_closure);
+}
+
+void timer::write_timer(const string probname, const string datadir) const {
+    // reduces elapsed times over all processes and writes minimum, mean, and maximum for each phase
+    // prints a summary table and writes the same information to datadir/probname_timer.txt
+    // time not spent in any other phase is reported as "other"
+    // subphases are already included in their parent phase and are indented below it
+
+    int id, np;
+    double times[nphases+1], tmin[nphases+1], tmax[nphases+1], tsum[nphases+1];
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &id);
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+    times[nphases] = elapsed[total];
+
+    for (int i=0; i<nphases; i++) {
+        times[i] = elapsed[i];
+        if (i != total && !is_subphase(i)) {
+            times[nphases] -= elapsed[i];
+        }
+    }
+
+    MPI_Reduce(times, tmin, nphases+1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(times, tmax, nphases+1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(times, tsum, nphases+1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (id != 0) { return; }
+
+    // order phases so that other comes before total
+
+    int order[nphases+1];
+
+    for (int i=0; i<nphases-1; i++) {
+        order[i] = i;
+    }
+    order[nphases-1] = nphases;
+    order[nphases] = total;
+
+    ofstream timerfile((datadir+probname+"_timer.txt").c_str(), ios::out);
+
+    if (!timerfile.is_open()) {
+        cerr << "Error opening timer file in timer.cpp\n";
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    timerfile << "# phase min mean max (seconds over " << np << " processes)\n";
+    timerfile << setprecision(8);
+
+    cout << "Time spent in each phase (seconds over all processes):\n";
+    cout << "  " << left << setw(16) << "phase" << right << setw(12) << "min" << setw(12) << "mean" << setw(12) << "max"
+         << setw(12) << "max/mean" << "\n";
+
+    for (int j=0; j<nphases+1; j++) {
+        const int i = order[j];
+        const char* phase = (i == nphases) ? "other" : phase_names[i];
+        const double tmean = tsum[i]/(double)np;
+        const bool sub = (i < nphases && is_subphase(i));
+        cout << (sub ? "    " : "  ") << left << setw(sub ? 14 : 16) << phase << right << setprecision(4) << setw(12) << tmin[i] << setw(12) << tmean
+             << setw(12) << tmax[i] << setw(12);
+        if (tmean > 0.) {
+            cout << tmax[i]/tmean << "\n";
+        } else {
+            cout << "-" << "\n";
+        }
+        timerfile << phase << " " << tmin[i] << " " << tmean << " " << tmax[i] << "\n";
+    }
+
+    cout << setprecision(6);
+
+    timerfile.close();
+}
@@ -0,0 +1,34 @@
+#ifndef TIMERCLASSHEADERDEF
+#define TIMERCLASSHEADERDEF
+
+#include <string>
+
+class timer
+{
+public:
+    timer();
+    void start(const int phase);
+    void stop(const int phase);
+    void write_timer(const std::string probname, const std::string datadir) const;
+    static bool is_subphase(const int phase);
+    static const int nphases = 14;
+    static const int scale_df = 0;
+    static const int calc_df = 1;
+    static const int df_interior = 2;
+    static const int df_closure = 3;
+    static const int set_boundaries = 4;
+    static const int exchange = 5;
+    static const int iface_bcs = 6;
+    static const int iface_calc_df = 7;
+    static const int iface_update = 8;
+    static const int update = 9;
+    static const int plastic = 10;
+    static const int output = 11;
+    static const int front = 12;
+    static const int total = 13;
+private:
+    double t0[nphases];
+    double elapsed[nphases];
+};
+
+#endif